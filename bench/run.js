@@ -0,0 +1,284 @@
+// Benchmark suite, run against bench/target.cc, a stand-in process with a
+// known memory layout.
+//
+// The target is compiled into build/ on first use (needs a C++ compiler and
+// the X11 headers the addon already builds against). Every suite prints one
+// entry in a single JSON document, so runs of different versions can be
+// diffed. The X11 suite starts a private Xvfb and is skipped if there is
+// none on PATH; nothing needs a GPU or network.
+//
+// --smoke shrinks the heap and time budget so a run takes seconds; every
+// suite still checks the target's layout, so this is what `npm test` runs.
+//
+//   node bench/run.js [--smoke] [--heap MiB] [--seconds s] [--only suite,...] [--out file]
+
+const { spawn, execFileSync } = require("child_process");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const memoryAccess = require(path.join(__dirname, "../build/Release/readmemlib.node"));
+
+function option(name, fallback) {
+  const at = process.argv.indexOf(`--${name}`);
+  return at >= 0 && at + 1 < process.argv.length ? process.argv[at + 1] : fallback;
+}
+
+const smoke = process.argv.includes("--smoke");
+const heapMiB = Number(option("heap", smoke ? 32 : 256));
+const seconds = Number(option("seconds", smoke ? 0.01 : 1));
+const only = option("only", null);
+const out = option("out", null);
+
+function buildTarget() {
+  const source = path.join(__dirname, "target.cc");
+  const binary = path.join(__dirname, "../build/bench-target");
+  if (!fs.existsSync(binary) || fs.statSync(binary).mtimeMs < fs.statSync(source).mtimeMs) {
+    fs.mkdirSync(path.dirname(binary), { recursive: true });
+    execFileSync(process.env.CXX || "c++", ["-O2", "-o", binary, source, "-lX11"], { stdio: "inherit" });
+  }
+  return binary;
+}
+
+// Resolves with the layout line the target prints once it is set up. Its
+// stdin stays open; closing it (or exiting) ends the target.
+function startTarget(binary, args, env) {
+  const child = spawn(binary, args, { stdio: ["pipe", "pipe", "inherit"], env: { ...process.env, ...env } });
+  return new Promise((resolve, reject) => {
+    let text = "";
+    child.on("error", reject);
+    child.on("exit", (code) => reject(new Error(`target exited with ${code}`)));
+    child.stdout.on("data", (chunk) => {
+      text += chunk;
+      if (text.includes("\n")) {
+        const layout = JSON.parse(text);
+        for (const key of ["player", "ints", "chain", "heap"]) {
+          layout[key] = BigInt(layout[key]);
+        }
+        layout.child = child;
+        resolve(layout);
+      }
+    });
+  });
+}
+
+function stopTarget(layout) {
+  layout.child.removeAllListeners("exit");
+  layout.child.stdin.end();
+  layout.child.kill();
+}
+
+// Calls fn in batches until the time budget is spent; returns calls/second.
+function opsPerSecond(fn, batch = 1000) {
+  fn();
+  let calls = 0;
+  const started = process.hrtime.bigint();
+  const budget = BigInt(Math.round(seconds * 1e9));
+  let elapsed = 0n;
+  while (elapsed < budget) {
+    for (let i = 0; i < batch; i++) {
+      fn();
+    }
+    calls += batch;
+    elapsed = process.hrtime.bigint() - started;
+  }
+  return Math.round(calls / (Number(elapsed) / 1e9));
+}
+
+// Per-call latency in microseconds, for calls too slow to batch.
+function latency(fn, iterations) {
+  fn();
+  const samples = [];
+  for (let i = 0; i < iterations; i++) {
+    const started = process.hrtime.bigint();
+    fn();
+    samples.push(Number(process.hrtime.bigint() - started) / 1000);
+  }
+  samples.sort((a, b) => a - b);
+  const at = (q) => Number(samples[Math.min(samples.length - 1, Math.floor(q * samples.length))].toFixed(1));
+  return { iterations, p50Us: at(0.5), p99Us: at(0.99), maxUs: at(1) };
+}
+
+function check(condition, what) {
+  if (!condition) {
+    throw new Error(`target layout mismatch: ${what}`);
+  }
+}
+
+const suites = {
+  readWrite(target) {
+    const { pid, player } = target;
+    check(memoryAccess.read_integer(pid, player) === 100, "player.hp");
+    return {
+      readIntegerOpsPerSecond: opsPerSecond(() => memoryAccess.read_integer(pid, player + 4n)),
+      writeIntegerOpsPerSecond: opsPerSecond(() => memoryAccess.write_integer(pid, player + 4n, 50)),
+      readF32OpsPerSecond: opsPerSecond(() => memoryAccess.read_f32(pid, player + 8n)),
+      readI64OpsPerSecond: opsPerSecond(() => memoryAccess.read_i64(pid, player + 24n)),
+    };
+  },
+
+  batch(target) {
+    const { pid, ints, intCount } = target;
+    const results = {};
+    for (const count of [16, 256, 4096]) {
+      // Every other value, so no two entries are adjacent.
+      const addresses = Array.from({ length: count }, (_, i) => ints + BigInt(((i * 2) % intCount) * 4));
+      const { data, failed } = memoryAccess.read_batch(pid, addresses, 4);
+      check(failed.length === 0 && data.readInt32LE(4) === 6, `read_batch of ${count}`);
+      const calls = opsPerSecond(() => memoryAccess.read_batch(pid, addresses, 4), 10);
+      results[`entries${count}`] = { callsPerSecond: calls, valuesPerSecond: calls * count };
+    }
+
+    const bytes = Buffer.alloc(16 << 20);
+    const calls = opsPerSecond(() => memoryAccess.read_bytes(pid, target.heap, bytes.length, bytes), 1);
+    results.readBytes16MiB = { callsPerSecond: calls, bytesPerSecond: calls * bytes.length };
+    return results;
+  },
+
+  pointerChains(target) {
+    const { pid, chain, chainOffsets, chainValue } = target;
+    const chains = Array.from({ length: 64 }, () => ({ base: chain, offsets: chainOffsets }));
+    const values = memoryAccess.resolve_pointer_chains(pid, chains, { type: "i32" });
+    check(values[0] === chainValue, "pointer chain");
+    return {
+      resolveOpsPerSecond: opsPerSecond(() => memoryAccess.resolve_pointer_chain(pid, chain, chainOffsets)),
+      resolve64ChainsOpsPerSecond: opsPerSecond(() => memoryAccess.resolve_pointer_chains(pid, chains, { type: "i32" }), 10),
+    };
+  },
+
+  sigscan(target) {
+    const { pid, heap, heapSize, planted } = target;
+    const filter = { start: heap, end: heap + BigInt(heapSize) };
+    const results = {};
+    for (const { name, signature, offset } of planted) {
+      const entry = {};
+      for (const threads of [1, os.cpus().length]) {
+        const scan = memoryAccess.sigscan(pid, signature, { ...filter, threads });
+        check(scan.address === heap + BigInt(offset), `${name} signature`);
+        entry[`threads${threads}`] = { gbPerSecond: Number((scan.bytesPerSecond / 1e9).toFixed(2)), seconds: scan.seconds };
+      }
+      results[name] = entry;
+    }
+
+    const signatures = planted.map((item) => item.signature);
+    const many = memoryAccess.sigscan_many(pid, signatures, filter);
+    results.many = { signatures: signatures.length, gbPerSecond: Number((many.bytesPerSecond / 1e9).toFixed(2)) };
+    return results;
+  },
+
+  // dump_memory of the heap through each backend; "auto" picks io_uring
+  // when the kernel allows it.
+  dump(target) {
+    const { pid, heap, heapSize } = target;
+    const output = path.join(os.tmpdir(), `readmemlib-bench-${process.pid}.dump`);
+    const expected = memoryAccess.read_bytes(pid, heap, 4096);
+    const results = {};
+    try {
+      for (const backend of ["pread", "io_uring"]) {
+        for (const blockSize of [256 << 10, 1 << 20]) {
+          for (const queueDepth of backend === "pread" ? [0] : [8, 32, 128]) {
+            if (results[backend]) {
+              continue;
+            }
+            const options = { start: heap, end: heap + BigInt(heapSize), output, backend, blockSize };
+            if (queueDepth) {
+              options.queueDepth = queueDepth;
+            }
+            let dump;
+            try {
+              dump = memoryAccess.dump_memory(pid, options);
+            } catch (error) {
+              results[backend] = { skipped: error.message };
+              continue;
+            }
+            const file = fs.openSync(output, "r");
+            const head = Buffer.alloc(4096);
+            fs.readSync(file, head, 0, head.length, dump.regions[0].offset);
+            fs.closeSync(file);
+            check(dump.bytesFailed === 0 && head.equals(expected), `${backend} dump`);
+            const name = `${backend}Block${blockSize >> 10}KiB` + (queueDepth ? `Depth${queueDepth}` : "");
+            results[name] = { gbPerSecond: Number((dump.bytesPerSecond / 1e9).toFixed(2)), registeredBuffers: dump.registeredBuffers };
+          }
+        }
+      }
+    } finally {
+      fs.rmSync(output, { force: true });
+    }
+    return results;
+  },
+
+  async x11(binary) {
+    const xvfb = process.env.PATH.split(path.delimiter).map((dir) => path.join(dir, "Xvfb")).find((file) => fs.existsSync(file));
+    if (!xvfb) {
+      return { skipped: "Xvfb not found on PATH" };
+    }
+
+    // -displayfd picks a free display and reports it once the server is up.
+    const server = spawn(xvfb, ["-displayfd", "3", "-nolisten", "tcp", "-screen", "0", "640x480x24"], {
+      stdio: ["ignore", "ignore", "ignore", "pipe"],
+    });
+    const display = await new Promise((resolve, reject) => {
+      server.on("error", reject);
+      server.stdio[3].once("data", (chunk) => resolve(`:${String(chunk).trim()}`));
+    });
+
+    const windows = 50;
+    const previous = process.env.DISPLAY;
+    process.env.DISPLAY = display;
+    const target = await startTarget(binary, ["2", "--windows", String(windows)], { DISPLAY: display });
+    try {
+      const last = `readmemlib-bench-${windows - 1}`;
+      check(memoryAccess.get_pid_from_window_title(last) === target.pid, "window pid");
+      return {
+        windows,
+        getPidFromWindowTitle: latency(() => memoryAccess.get_pid_from_window_title(last), 500),
+        getPidsFromPartialTitle: latency(() => memoryAccess.get_pids_from_partial_title("readmemlib-bench-"), 500),
+        getWindowTitleByPid: latency(() => memoryAccess.get_window_title_by_pid(target.pid), 500),
+      };
+    } finally {
+      stopTarget(target);
+      server.kill();
+      if (previous === undefined) {
+        delete process.env.DISPLAY;
+      } else {
+        process.env.DISPLAY = previous;
+      }
+    }
+  },
+};
+
+async function main() {
+  const binary = buildTarget();
+  const selected = only ? only.split(",") : Object.keys(suites);
+  const report = {
+    benchmark: "readmemlib",
+    version: require("../package.json").version,
+    node: process.version,
+    cpu: os.cpus()[0].model,
+    cpus: os.cpus().length,
+    kernel: os.release(),
+    smoke,
+    heapMiB,
+    secondsPerMeasurement: seconds,
+    results: {},
+  };
+
+  const target = await startTarget(binary, [String(heapMiB)]);
+  try {
+    for (const name of selected) {
+      report.results[name] = name === "x11" ? await suites.x11(binary) : suites[name](target);
+    }
+  } finally {
+    stopTarget(target);
+  }
+
+  const json = JSON.stringify(report, null, 2);
+  if (out) {
+    fs.writeFileSync(out, json + "\n");
+  }
+  console.log(json);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
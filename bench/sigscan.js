@@ -0,0 +1,50 @@
+// Compares the sigscan matching kernels on the same memory.
+//
+// A child node process holds a large random Buffer with a signature planted
+// at its end; every kernel scans the child's rw- regions on one thread, so
+// the numbers reflect matching speed rather than thread count. Speedups are
+// against "legacy", the compare loop sigscan used before the kernels.
+//
+//   node bench/sigscan.js [sizeMiB]
+
+const { spawn } = require("child_process");
+const path = require("path");
+const memoryAccess = require(path.join(__dirname, "../build/Release/readmemlib.node"));
+
+const sizeMiB = Number(process.argv[2] || 256);
+const pattern = [0x48, 0x8b, 0x05, 0x11, 0x22, 0x33, 0x44, 0x48, 0x85, 0xc0, 0x74, 0x0e];
+const signature = "48 8B 05 ?? ?? ?? ?? 48 85 C0 74 ??";
+const kernels = ["legacy", "scalar", "memchr", "sse2", "avx2", "auto"];
+
+// The pattern is written byte by byte so it never exists as a contiguous
+// array anywhere else in the child.
+const target = `
+  const buf = Buffer.allocUnsafe(${sizeMiB} * 1024 * 1024);
+  require("crypto").randomFillSync(buf);
+  const pattern = ${JSON.stringify(pattern)};
+  for (let i = 0; i < pattern.length; i++) buf[buf.length - 64 + i] = pattern[i];
+  process.stdout.write("ready\\n");
+  setInterval(() => buf, 1 << 30);
+`;
+
+const child = spawn(process.execPath, ["-e", target], { stdio: ["ignore", "pipe", "inherit"] });
+child.stdout.once("data", () => {
+  const results = [];
+  for (const kernel of kernels) {
+    const scan = memoryAccess.sigscan(child.pid, signature, { perms: "rw-", threads: 1, kernel });
+    results.push({
+      kernel,
+      found: scan.address !== null,
+      bytesScanned: scan.bytesScanned,
+      seconds: scan.seconds,
+      bytesPerSecond: Math.round(scan.bytesPerSecond),
+    });
+  }
+
+  const baseline = results[0].bytesPerSecond;
+  for (const result of results) {
+    result.speedup = Number((result.bytesPerSecond / baseline).toFixed(2));
+  }
+  console.log(JSON.stringify({ benchmark: "sigscan-kernels", sizeMiB, signature, results }, null, 2));
+  child.kill();
+});
@@ -0,0 +1,185 @@
+// Stand-in target for the benchmarks: a process with a known memory layout.
+//
+// On start it prints one JSON line describing where everything lives, then
+// sleeps until stdin closes, so it never outlives the runner:
+//   - player: a fixed struct (i32 hp, i32 armor, f32 x/y/z, i64 score)
+//   - ints: 65536 i32 values, ints[i] == i * 3
+//   - chain: [[[chain+0x10]+0x48]+0x20]+0x8 holds the i32 1337
+//   - heap: heapMiB of pseudo-random bytes, one copy of each signature
+//     planted in the last MiB at the reported offsets
+// With --windows N and a DISPLAY, it also creates N unmapped windows named
+// "readmemlib-bench-<i>" carrying _NET_WM_PID and publishes them in the root
+// window's _NET_CLIENT_LIST, standing in for a window manager under Xvfb.
+//
+//   c++ -O2 -o target bench/target.cc -lX11
+//   ./target [heapMiB] [--windows N]
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+struct Player
+{
+  int32_t hp;
+  int32_t armor;
+  float x;
+  float y;
+  float z;
+  int64_t score;
+};
+
+static Player player = {100, 50, 1.5f, -2.25f, 10.0f, 123456789012LL};
+static int32_t ints[65536];
+
+struct Planted
+{
+  const char *name;
+  const char *signature;
+};
+
+// Writes the signature's bytes straight into dst, wildcards as 0x00, so no
+// other copy of the pattern exists in the process to be found first.
+static void plant(const char *signature, unsigned char *dst)
+{
+  for (const char *p = signature; *p;)
+  {
+    if (*p == ' ')
+    {
+      ++p;
+      continue;
+    }
+    if (*p == '?')
+    {
+      *dst++ = 0;
+      p += p[1] == '?' ? 2 : 1;
+      continue;
+    }
+    char hex[3] = {p[0], p[1], 0};
+    *dst++ = (unsigned char)strtoul(hex, nullptr, 16);
+    p += 2;
+  }
+}
+
+static unsigned char *build_chain()
+{
+  unsigned char *nodes[4];
+  for (unsigned char *&node : nodes)
+  {
+    node = static_cast<unsigned char *>(calloc(1, 0x100));
+  }
+  memcpy(nodes[0] + 0x10, &nodes[1], 8);
+  memcpy(nodes[1] + 0x48, &nodes[2], 8);
+  memcpy(nodes[2] + 0x20, &nodes[3], 8);
+  int32_t value = 1337;
+  memcpy(nodes[3] + 0x8, &value, 4);
+  return nodes[0];
+}
+
+static void publish_windows(int count)
+{
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    fprintf(stderr, "target: cannot open display\n");
+    return;
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom pid_property = XInternAtom(display, "_NET_WM_PID", false);
+  Atom client_list = XInternAtom(display, "_NET_CLIENT_LIST", false);
+  unsigned long pid = getpid();
+  std::vector<Window> windows;
+  for (int i = 0; i < count; ++i)
+  {
+    Window window = XCreateSimpleWindow(display, root, 0, 0, 64, 64, 0, 0, 0);
+    std::string name = "readmemlib-bench-" + std::to_string(i);
+    XStoreName(display, window, name.c_str());
+    XChangeProperty(display, window, pid_property, XA_CARDINAL, 32, PropModeReplace,
+                    (unsigned char *)&pid, 1);
+    windows.push_back(window);
+  }
+  XChangeProperty(display, root, client_list, XA_WINDOW, 32, PropModeReplace,
+                  (unsigned char *)windows.data(), windows.size());
+  // The display stays open: closing it would destroy the windows.
+  XSync(display, false);
+}
+
+int main(int argc, char **argv)
+{
+  size_t heap_mib = 256;
+  int windows = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc)
+    {
+      windows = atoi(argv[++i]);
+    }
+    else
+    {
+      heap_mib = strtoul(argv[i], nullptr, 10);
+    }
+  }
+  if (heap_mib < 2)
+  {
+    heap_mib = 2;
+  }
+
+  for (int i = 0; i < 65536; ++i)
+  {
+    ints[i] = i * 3;
+  }
+  unsigned char *chain = build_chain();
+
+  size_t heap_size = heap_mib << 20;
+  unsigned char *heap = static_cast<unsigned char *>(malloc(heap_size));
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i + 8 <= heap_size; i += 8)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    memcpy(heap + i, &state, 8);
+  }
+
+  std::vector<Planted> planted = {
+      {"short", "48 8B 05 ?? ?? ?? ?? 48 85 C0"},
+      {"long", "55 48 89 E5 41 57 41 56 41 55 41 54 53 48 83 EC ?? 48 8B 05 ?? ?? ?? ?? 48 89 45 C8 31 C0 48 8D"},
+      {"leading-wildcard", "?? ?? ?? ?? 89 5C 24 08 57 48 83 EC 20"},
+      {"common-first-byte", "00 00 00 00 00 00 00 00 DE AD BE EF"},
+  };
+  size_t offset = heap_size - (1 << 20);
+  std::string planted_json;
+  for (const Planted &item : planted)
+  {
+    plant(item.signature, heap + offset);
+    char entry[256];
+    snprintf(entry, sizeof(entry), "%s{\"name\":\"%s\",\"signature\":\"%s\",\"offset\":%zu}",
+             planted_json.empty() ? "" : ",", item.name, item.signature, offset);
+    planted_json += entry;
+    offset += 4096;
+  }
+
+  if (windows > 0)
+  {
+    publish_windows(windows);
+  }
+
+  printf("{\"pid\":%d,\"player\":\"0x%lx\",\"ints\":\"0x%lx\",\"intCount\":65536,"
+         "\"chain\":\"0x%lx\",\"chainOffsets\":[16,72,32,8],\"chainValue\":1337,"
+         "\"heap\":\"0x%lx\",\"heapSize\":%zu,\"planted\":[%s],\"windows\":%d}\n",
+         getpid(), (unsigned long)&player, (unsigned long)ints, (unsigned long)chain,
+         (unsigned long)heap, heap_size, planted_json.c_str(), windows);
+  fflush(stdout);
+
+  char buf[64];
+  while (read(0, buf, sizeof(buf)) > 0)
+  {
+  }
+  return 0;
+}
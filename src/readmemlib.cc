@@ -14,289 +14,3945 @@
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/shape.h>
 #include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <map>
+#include <functional>
+#include <condition_variable>
+#include <chrono>
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <dirent.h>
+#include <elf.h>
+#include <sys/stat.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #include <gtk/gtk.h>
 #include <webkit2/webkit2.h>
 
 using namespace Napi;
 
-Napi::Value read_integer(const Napi::CallbackInfo &info)
+// A freeze() in effect, see freeze() below.
+struct FreezeSession
 {
-  Napi::Env env = info.Env();
+  int depth;
+  // Each stopped thread, with a signal that arrived while stopping it and
+  // has to be passed on when it is let go.
+  std::vector<std::pair<pid_t, int>> threads;
+};
 
-  if (info.Length() < 2)
-  {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
-  }
+struct AddonData
+{
+  Napi::FunctionReference process_handle;
+  Napi::FunctionReference signature_handle;
+  Napi::FunctionReference value_scan;
+  Napi::FunctionReference snapshot;
+  Napi::FunctionReference watcher;
+  Napi::FunctionReference struct_layout;
+  Napi::FunctionReference sampler;
+  std::unordered_map<pid_t, FreezeSession> freeze_sessions;
+};
+
+// Per-export call statistics. Each thread owns a slot holding one block of
+// counters per export it has touched; only the owner writes to it, so a hot
+// path costs a few plain adds and no shared cache lines. get_stats() sums
+// the slots, and reset_stats() records the sums as a baseline instead of
+// clearing counters under their writers. Latencies go into HDR-style buckets:
+// 8 linear sub-buckets per power of two of nanoseconds, about 12% wide.
+const size_t STATS_MAX_EXPORTS = 128;
+const size_t STATS_SUB_BUCKETS = 8;
+const size_t STATS_BUCKETS = STATS_SUB_BUCKETS * 40;
+
+struct ExportCounters
+{
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> errors{0};
+  std::atomic<uint64_t> bytes_read{0};
+  std::atomic<uint64_t> bytes_written{0};
+  std::atomic<uint64_t> latency[STATS_BUCKETS] = {};
+};
+
+struct StatsSlot
+{
+  std::atomic<ExportCounters *> exports[STATS_MAX_EXPORTS] = {};
+  bool in_use = true;
+};
 
-  if (!info[0].IsNumber() || !info[1].IsNumber())
-  {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
-  }
+std::mutex stats_mutex;
+std::vector<StatsSlot *> stats_slots;
+std::vector<std::string> stats_exports;
 
-  pid_t pid = info[0].As<Napi::Number>().Int32Value();
-  unsigned long addr = info[1].As<Napi::Number>().Uint32Value();
+// The export the current thread is working for, or -1. Pool threads and the
+// threads behind async exports, watchers and samplers take it over from the
+// call that handed them the work, so their bytes are counted to it.
+thread_local int current_export = -1;
 
-  ptrace(PTRACE_INTERRUPT, pid, NULL, PTRACE_O_TRACEEXEC);
-  std::stringstream ss;
-  ss << "/proc/" << pid << "/mem";
-  std::fstream fs(ss.str().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+// Hands the slot back for reuse when its thread exits; the counts stay.
+struct StatsSlotOwner
+{
+  StatsSlot *slot = nullptr;
 
-  if (!fs.is_open())
+  ~StatsSlotOwner()
   {
-    Napi::Error::New(env, "Failed to open " + ss.str()).ThrowAsJavaScriptException();
-    return env.Null();
+    if (slot)
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex);
+      slot->in_use = false;
+    }
   }
+};
 
-  fs.seekg(addr);
-  char buf[4];
-  fs.read(buf, 4);
-  int value = *(int *)buf;
-  fs.close();
+thread_local StatsSlotOwner stats_slot_owner;
 
-  return Napi::Number::New(env, value);
-}
-Napi::Value write_integer(const Napi::CallbackInfo &info)
+ExportCounters *export_counters(int id)
 {
-  Napi::Env env = info.Env();
-  if (info.Length() < 3)
+  StatsSlot *slot = stats_slot_owner.slot;
+  if (!slot)
   {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    for (StatsSlot *free_slot : stats_slots)
+    {
+      if (!free_slot->in_use)
+      {
+        slot = free_slot;
+        break;
+      }
+    }
+    if (!slot)
+    {
+      slot = new StatsSlot();
+      stats_slots.push_back(slot);
+    }
+    slot->in_use = true;
+    stats_slot_owner.slot = slot;
   }
-
-  if (!info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
+  ExportCounters *counters = slot->exports[id].load(std::memory_order_relaxed);
+  if (!counters)
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
+    counters = new ExportCounters();
+    slot->exports[id].store(counters, std::memory_order_release);
   }
+  return counters;
+}
 
-  pid_t pid = info[0].As<Napi::Number>().Int32Value();
-  unsigned long addr = info[1].As<Napi::Number>().Uint32Value();
-  int value = info[2].As<Napi::Number>().Int32Value();
-
-  ptrace(PTRACE_INTERRUPT, pid, NULL, PTRACE_O_TRACEEXEC);
-  wait(NULL);
-  std::stringstream ss;
-  ss << "/proc/" << pid << "/mem";
-  std::fstream fs(ss.str().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+// Single writer: a relaxed load and store, not a locked read-modify-write.
+inline void stats_add(std::atomic<uint64_t> &counter, uint64_t n)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
 
-  if (!fs.is_open())
+size_t latency_bucket(uint64_t ns)
+{
+  if (ns < STATS_SUB_BUCKETS)
   {
-    Napi::Error::New(env, "Failed to open " + ss.str()).ThrowAsJavaScriptException();
-    return env.Null();
+    return ns;
   }
-
-  fs.seekp(addr);
-  fs.write((char *)&value, sizeof(value));
-  fs.close();
-  ptrace(PTRACE_DETACH, pid, NULL, NULL);
-  return env.Null();
+  int exponent = 63 - __builtin_clzll(ns);
+  size_t bucket = STATS_SUB_BUCKETS * (exponent - 2) + ((ns >> (exponent - 3)) & (STATS_SUB_BUCKETS - 1));
+  return std::min(bucket, STATS_BUCKETS - 1);
 }
-Napi::Value get_pid_from_window_title(const Napi::CallbackInfo &info)
-{
-  Napi::Env env = info.Env();
 
-  if (info.Length() < 1)
+// The largest latency that lands in a bucket.
+uint64_t bucket_limit(size_t bucket)
+{
+  if (bucket < STATS_SUB_BUCKETS)
   {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
+    return bucket;
   }
+  int exponent = bucket / STATS_SUB_BUCKETS + 2;
+  uint64_t sub = bucket % STATS_SUB_BUCKETS;
+  return ((STATS_SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+}
 
-  if (!info[0].IsString())
+void count_bytes_read(size_t n)
+{
+  if (current_export >= 0 && n > 0)
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
+    stats_add(export_counters(current_export)->bytes_read, n);
   }
+}
 
-  std::string window_title = info[0].As<Napi::String>();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+void count_bytes_written(size_t n)
+{
+  if (current_export >= 0 && n > 0)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
-    return env.Null();
+    stats_add(export_counters(current_export)->bytes_written, n);
   }
+}
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
+// Makes the calling thread work for an export until the scope ends.
+class ExportScope
+{
+public:
+  explicit ExportScope(int id) : previous(current_export)
+  {
+    current_export = id;
+  }
 
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  ~ExportScope()
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
-    return env.Null();
+    current_export = previous;
   }
 
-  Window *window_list = (Window *)data;
-  pid_t pid = -1;
+private:
+  int previous;
+};
 
-  for (unsigned long i = 0; i < num_windows; ++i)
+// An open /proc/<pid>/mem descriptor, kept for as long as someone holds the
+// process. The descriptor stays bound to the process it was opened for, so a
+// recycled pid can never be read through it; start_time tells the two apart.
+struct ProcessMemory
+{
+  pid_t pid;
+  unsigned long long start_time;
+  int fd;
+  int pidfd;
+  bool writable;
+  std::atomic<bool> exited;
+
+  ProcessMemory() : pid(0), start_time(0), fd(-1), pidfd(-1), writable(false), exited(false) {}
+  ~ProcessMemory()
   {
-    Window window = window_list[i];
-    char *name;
-    if (XFetchName(display, window, &name) > 0)
+    if (fd >= 0)
     {
-      std::string current_title(name);
-      XFree(name);
-
-      if (current_title == window_title)
-      {
-        Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-        Atom pid_type;
-        int pid_format;
-        unsigned long pid_nitems, pid_bytes_remaining;
-        unsigned char *pid_data = NULL;
-
-        if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                               &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
-        {
-          if (pid_data != NULL)
-          {
-            pid = *((pid_t *)pid_data);
-            XFree(pid_data);
-            break;
-          }
-        }
-      }
+      close(fd);
+    }
+    if (pidfd >= 0)
+    {
+      close(pidfd);
     }
   }
+};
 
-  XFree(window_list);
-  XCloseDisplay(display);
+// Reads the start time (field 22, clock ticks) and virtual size (field 23)
+// from /proc/<pid>/stat. Returns false if there is no such process.
+bool read_process_stat(pid_t pid, unsigned long long &start_time, unsigned long long &vsize)
+{
+  char path[32];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  char stat[1024];
+  ssize_t n = read(fd, stat, sizeof(stat) - 1);
+  close(fd);
+  if (n <= 0)
+  {
+    return false;
+  }
+  stat[n] = 0;
 
-  if (pid != -1)
+  // The command name may contain spaces and parentheses, fields resume after the last ')'.
+  char *p = std::strrchr(stat, ')');
+  if (!p)
   {
-    return Napi::Number::New(env, pid);
+    return false;
   }
-  else
+  ++p;
+  for (int field = 3; field < 22 && p; ++field)
   {
-    Napi::Error::New(env, "Window with the specified title not found").ThrowAsJavaScriptException();
-    return env.Null();
+    p = std::strchr(p + 1, ' ');
+  }
+  if (!p)
+  {
+    return false;
   }
+  start_time = std::strtoull(p + 1, &p, 10);
+  vsize = std::strtoull(p + 1, &p, 10);
+  return start_time != 0;
 }
 
-Napi::Value get_pids_from_partial_title(const Napi::CallbackInfo &info)
+// Returns the start time of the process, or 0 if there is no such process.
+unsigned long long process_start_time(pid_t pid)
 {
-  Napi::Env env = info.Env();
+  unsigned long long start_time, vsize;
+  return read_process_stat(pid, start_time, vsize) ? start_time : 0;
+}
 
-  if (info.Length() < 1)
+std::shared_ptr<ProcessMemory> open_process_memory(pid_t pid, std::string &error)
+{
+  std::stringstream ss;
+  ss << "/proc/" << pid << "/mem";
+
+  auto proc = std::make_shared<ProcessMemory>();
+  proc->pid = pid;
+  proc->start_time = process_start_time(pid);
+  proc->fd = open(ss.str().c_str(), O_RDWR | O_CLOEXEC);
+  proc->writable = true;
+  if (proc->fd < 0 && errno == EACCES)
   {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
+    proc->fd = open(ss.str().c_str(), O_RDONLY | O_CLOEXEC);
+    proc->writable = false;
   }
 
-  if (!info[0].IsString())
+  if (proc->fd < 0 || proc->start_time == 0)
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
+    error = "Failed to open " + ss.str();
+    return nullptr;
   }
 
-  std::string partial_title = info[0].As<Napi::String>();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+#ifdef SYS_pidfd_open
+  // process_vm_readv/writev address the target by pid. A pidfd lets them
+  // notice afterwards that the pid was recycled while they ran.
+  proc->pidfd = syscall(SYS_pidfd_open, pid, 0);
+  if (proc->pidfd >= 0 && process_start_time(pid) != proc->start_time)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
-    return env.Null();
+    error = "Failed to open " + ss.str();
+    return nullptr;
   }
+#endif
+  return proc;
+}
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
-
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+// Checks that the process behind proc is still the one that was opened.
+bool process_alive(ProcessMemory &proc)
+{
+  if (proc.exited)
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
-    return env.Null();
+    return false;
   }
+  if (process_start_time(proc.pid) != proc.start_time)
+  {
+    proc.exited = true;
+    return false;
+  }
+  return true;
+}
 
-  Window *window_list = (Window *)data;
-  Napi::Array result = Napi::Array::New(env);
-
-  for (unsigned long i = 0; i < num_windows; ++i)
+ssize_t read_memory(ProcessMemory &proc, unsigned long long addr, void *buf, size_t len)
+{
+  ssize_t n = pread(proc.fd, buf, len, (off_t)addr);
+  if (n <= 0)
   {
-    Window window = window_list[i];
-    char *name;
-    if (XFetchName(display, window, &name) > 0)
-    {
-      std::string current_title(name);
-      XFree(name);
+    process_alive(proc);
+  }
+  else
+  {
+    count_bytes_read(n);
+  }
+  return n;
+}
 
-      if (current_title.find(partial_title) != std::string::npos)
-      {
-        Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-        Atom classname_property = XInternAtom(display, "WM_CLASS", true);
-        Atom pid_type, classname_type;
-        int pid_format, classname_format;
-        unsigned long pid_nitems, classname_nitems, pid_bytes_remaining, classname_bytes_remaining;
-        unsigned char *pid_data = NULL, *classname_data = NULL;
+ssize_t write_memory(ProcessMemory &proc, unsigned long long addr, const void *buf, size_t len)
+{
+  ssize_t n = pwrite(proc.fd, buf, len, (off_t)addr);
+  if (n <= 0)
+  {
+    process_alive(proc);
+  }
+  else
+  {
+    count_bytes_written(n);
+  }
+  return n;
+}
 
-        if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                               &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success &&
-            XGetWindowProperty(display, window, classname_property, 0, (~0L), false, XA_STRING,
-                               &classname_type, &classname_format, &classname_nitems, &classname_bytes_remaining, &classname_data) == Success)
-        {
-          if (pid_data != NULL && classname_data != NULL)
-          {
-            pid_t pid = *((pid_t *)pid_data);
-            std::string classname(reinterpret_cast<char *>(classname_data));
+struct MemoryRange
+{
+  unsigned long long addr;
+  void *buf;
+  size_t len;
+};
 
-            Napi::Object entry = Napi::Object::New(env);
-            entry.Set("pid", Napi::Number::New(env, pid));
-            entry.Set("title", Napi::String::New(env, current_title));
-            entry.Set("classname", Napi::String::New(env, classname));
+std::atomic<bool> vm_readv_unavailable(false);
 
-            result.Set(result.Length(), entry);
-            XFree(pid_data);
-            XFree(classname_data);
-          }
-        }
-      }
-    }
+// True if the pidfd reports the process has exited since it was opened.
+bool pidfd_exited(ProcessMemory &proc)
+{
+  struct pollfd pfd = {proc.pidfd, POLLIN, 0};
+  if (poll(&pfd, 1, 0) > 0)
+  {
+    proc.exited = true;
+    return true;
   }
-
-  XFree(window_list);
-  XCloseDisplay(display);
-
-  return result;
+  return false;
 }
 
-Napi::Value get_window_title_by_pid(const Napi::CallbackInfo &info)
+// Reads many disjoint ranges with as few process_vm_readv calls as possible,
+// falling back to a pread per range when the syscall is unavailable or the
+// process has no pidfd. ok[i] is set to 1 for every range read in full and 0
+// otherwise; a failed range does not affect the ones after it. Returns the
+// number of ranges read.
+size_t read_ranges(ProcessMemory &proc, const MemoryRange *ranges, size_t count, unsigned char *ok)
 {
-  Napi::Env env = info.Env();
+  size_t succeeded = 0;
+  size_t i = 0;
 
-  if (info.Length() < 1)
+  while (i < count && proc.pidfd >= 0 && !vm_readv_unavailable)
   {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
+    size_t n = std::min(count - i, (size_t)IOV_MAX);
+    struct iovec local[IOV_MAX];
+    struct iovec remote[IOV_MAX];
+    for (size_t k = 0; k < n; ++k)
+    {
+      local[k].iov_base = ranges[i + k].buf;
+      local[k].iov_len = ranges[i + k].len;
+      remote[k].iov_base = (void *)ranges[i + k].addr;
+      remote[k].iov_len = ranges[i + k].len;
+    }
+
+    ssize_t got = process_vm_readv(proc.pid, local, n, remote, n, 0);
+    if (got < 0 && (errno == ENOSYS || errno == EPERM))
+    {
+      vm_readv_unavailable = errno == ENOSYS;
+      break;
+    }
+    if ((got < 0 && errno == ESRCH) || pidfd_exited(proc))
+    {
+      proc.exited = true;
+      std::memset(ok + i, 0, count - i);
+      return 0;
+    }
+
+    // The transfer stops at the first range that touches an unmapped page.
+    // Account for the complete ranges, skip the failed one and carry on.
+    size_t remaining = got > 0 ? got : 0;
+    count_bytes_read(remaining);
+    size_t end = i + n;
+    while (i < end && remaining >= ranges[i].len)
+    {
+      remaining -= ranges[i].len;
+      ok[i++] = 1;
+      ++succeeded;
+    }
+    if (i < end)
+    {
+      ok[i++] = 0;
+    }
   }
 
-  if (!info[0].IsNumber())
+  for (; i < count; ++i)
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
+    ok[i] = read_memory(proc, ranges[i].addr, ranges[i].buf, ranges[i].len) == (ssize_t)ranges[i].len;
+    succeeded += ok[i];
   }
+  return succeeded;
+}
 
-  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+// Write counterpart of read_ranges. process_vm_writev refuses read-only
+// mappings that /proc/<pid>/mem can still patch, so ranges it fails on are
+// retried with pwrite. Returns the number of bytes written.
+size_t write_ranges(ProcessMemory &proc, const MemoryRange *ranges, size_t count, unsigned char *ok)
+{
+  size_t written = 0;
+  size_t i = 0;
+  std::vector<size_t> retry;
 
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+  while (i < count && proc.pidfd >= 0 && !vm_readv_unavailable)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
-    return env.Null();
-  }
+    size_t n = std::min(count - i, (size_t)IOV_MAX);
+    struct iovec local[IOV_MAX];
+    struct iovec remote[IOV_MAX];
+    for (size_t k = 0; k < n; ++k)
+    {
+      local[k].iov_base = ranges[i + k].buf;
+      local[k].iov_len = ranges[i + k].len;
+      remote[k].iov_base = (void *)ranges[i + k].addr;
+      remote[k].iov_len = ranges[i + k].len;
+    }
+
+    ssize_t put = process_vm_writev(proc.pid, local, n, remote, n, 0);
+    if (put < 0 && (errno == ENOSYS || errno == EPERM))
+    {
+      vm_readv_unavailable = errno == ENOSYS;
+      break;
+    }
+    if ((put < 0 && errno == ESRCH) || pidfd_exited(proc))
+    {
+      proc.exited = true;
+      std::memset(ok + i, 0, count - i);
+      return written;
+    }
+
+    size_t remaining = put > 0 ? put : 0;
+    count_bytes_written(remaining);
+    size_t end = i + n;
+    while (i < end && remaining >= ranges[i].len)
+    {
+      remaining -= ranges[i].len;
+      written += ranges[i].len;
+      ok[i++] = 1;
+    }
+    if (i < end)
+    {
+      // Any part of this range already written is simply written again.
+      retry.push_back(i++);
+    }
+  }
+
+  for (; i < count; ++i)
+  {
+    retry.push_back(i);
+  }
+  for (size_t k : retry)
+  {
+    ssize_t put = proc.writable ? write_memory(proc, ranges[k].addr, ranges[k].buf, ranges[k].len) : -1;
+    ok[k] = put == (ssize_t)ranges[k].len;
+    if (put > 0)
+    {
+      written += put;
+    }
+  }
+  return written;
+}
+
+struct MemoryRegion
+{
+  unsigned long long start;
+  unsigned long long end;
+  char perms[5];
+  unsigned long long offset;
+  unsigned long long inode;
+  std::string path;
+};
+
+// A parsed /proc/<pid>/maps. Tables are immutable once built; a refresh
+// replaces the cached table, so callers can keep using the one they hold.
+struct ProcessMaps
+{
+  unsigned long long start_time;
+  // Length and FNV-1a hash of the maps text the table was parsed from.
+  size_t text_size;
+  uint64_t fingerprint;
+  std::vector<MemoryRegion> regions;
+  std::unordered_map<std::string, unsigned long long> module_bases;
+
+  // Binary search for the region containing addr.
+  const MemoryRegion *find(unsigned long long addr) const
+  {
+    auto it = std::upper_bound(regions.begin(), regions.end(), addr,
+                               [](unsigned long long a, const MemoryRegion &region)
+                               { return a < region.start; });
+    if (it == regions.begin() || addr >= (it - 1)->end)
+    {
+      return nullptr;
+    }
+    return &*(it - 1);
+  }
+};
+
+std::string path_basename(const std::string &path)
+{
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Reads /proc/<pid>/maps whole; the kernel builds it a page at a time.
+bool read_maps_text(pid_t pid, std::string &text)
+{
+  std::string path = "/proc/" + std::to_string(pid) + "/maps";
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  text.clear();
+  char buf[65536];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+  {
+    text.append(buf, n);
+  }
+  close(fd);
+  return n == 0;
+}
+
+uint64_t maps_fingerprint(const std::string &text)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : text)
+  {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+void parse_maps(const std::string &text, ProcessMaps &maps)
+{
+  std::istringstream maps_file(text);
+  std::string line;
+  while (std::getline(maps_file, line))
+  {
+    // start-end perms offset dev inode [path]
+    MemoryRegion region;
+    const char *p = line.c_str();
+    char *next;
+    region.start = std::strtoull(p, &next, 16);
+    region.end = std::strtoull(next + 1, &next, 16);
+    std::memcpy(region.perms, next + 1, 4);
+    region.perms[4] = 0;
+    region.offset = std::strtoull(next + 6, &next, 16);
+    next = std::strchr(next + 1, ' ');
+    if (!next)
+    {
+      continue;
+    }
+    region.inode = std::strtoull(next + 1, &next, 10);
+    while (*next == ' ')
+    {
+      ++next;
+    }
+    region.path = next;
+
+    if (!region.path.empty() && region.path[0] == '/')
+    {
+      // Modules are known by full path and by file name; the base is the lowest mapping.
+      maps.module_bases.emplace(region.path, region.start);
+      maps.module_bases.emplace(path_basename(region.path), region.start);
+    }
+    maps.regions.push_back(region);
+  }
+}
+
+// A cached region table and when its maps text was last compared.
+struct CachedMaps
+{
+  std::shared_ptr<const ProcessMaps> maps;
+  std::chrono::steady_clock::time_point checked;
+};
+
+std::mutex maps_cache_mutex;
+std::unordered_map<pid_t, CachedMaps> maps_cache;
+
+// How long MAPS_CACHED lookups trust a table without reading the text.
+const std::chrono::milliseconds maps_recheck_interval(250);
+
+// How much get_maps trusts the cached table:
+//   MAPS_CACHED   as is when it was compared within maps_recheck_interval,
+//                 for lookups that recheck themselves after a miss
+//   MAPS_CHECKED  after comparing the maps text now, for scans
+//   MAPS_RELOAD   not at all, the text is parsed again
+enum MapsCheck
+{
+  MAPS_CACHED,
+  MAPS_CHECKED,
+  MAPS_RELOAD
+};
+
+// Returns the region table for pid. A check reads /proc/<pid>/maps and
+// reparses it only when the pid belongs to a new process or the text no
+// longer has the length and hash the table was built from, which catches
+// mprotect, remaps of the same size and modules reloaded at a new base.
+// Returns null if the process does not exist.
+std::shared_ptr<const ProcessMaps> get_maps(pid_t pid, MapsCheck check)
+{
+  auto now = std::chrono::steady_clock::now();
+  if (check == MAPS_CACHED)
+  {
+    std::lock_guard<std::mutex> lock(maps_cache_mutex);
+    auto it = maps_cache.find(pid);
+    if (it != maps_cache.end() && now - it->second.checked < maps_recheck_interval)
+    {
+      return it->second.maps;
+    }
+  }
+
+  unsigned long long start_time, vsize;
+  std::string text;
+  if (!read_process_stat(pid, start_time, vsize) || !read_maps_text(pid, text))
+  {
+    std::lock_guard<std::mutex> lock(maps_cache_mutex);
+    maps_cache.erase(pid);
+    return nullptr;
+  }
+  uint64_t fingerprint = maps_fingerprint(text);
+
+  {
+    std::lock_guard<std::mutex> lock(maps_cache_mutex);
+    auto it = maps_cache.find(pid);
+    if (check != MAPS_RELOAD && it != maps_cache.end())
+    {
+      const ProcessMaps &cached = *it->second.maps;
+      if (cached.start_time == start_time && cached.text_size == text.size() && cached.fingerprint == fingerprint)
+      {
+        it->second.checked = now;
+        return it->second.maps;
+      }
+    }
+  }
+
+  auto maps = std::make_shared<ProcessMaps>();
+  maps->start_time = start_time;
+  maps->text_size = text.size();
+  maps->fingerprint = fingerprint;
+  parse_maps(text, *maps);
+
+  std::lock_guard<std::mutex> lock(maps_cache_mutex);
+  maps_cache[pid] = {maps, now};
+  return maps;
+}
+
+std::mutex process_cache_mutex;
+std::unordered_map<pid_t, std::shared_ptr<ProcessMemory>> process_cache;
+std::chrono::steady_clock::time_point process_cache_swept;
+
+// Drops cached descriptors and region tables whose process has exited, so
+// they are released even if that pid is never asked for again. The pidfd
+// makes this a poll per descriptor; tables of pids without one compare the
+// start time instead.
+void sweep_process_cache()
+{
+  process_cache_swept = std::chrono::steady_clock::now();
+  for (auto it = process_cache.begin(); it != process_cache.end();)
+  {
+    ProcessMemory &proc = *it->second;
+    bool gone = proc.exited || (proc.pidfd >= 0 ? pidfd_exited(proc) : !process_alive(proc));
+    it = gone ? process_cache.erase(it) : std::next(it);
+  }
+
+  std::lock_guard<std::mutex> lock(maps_cache_mutex);
+  for (auto it = maps_cache.begin(); it != maps_cache.end();)
+  {
+    auto proc = process_cache.find(it->first);
+    bool alive = proc != process_cache.end() ? proc->second->start_time == it->second.maps->start_time
+                                             : process_start_time(it->first) == it->second.maps->start_time;
+    it = alive ? std::next(it) : maps_cache.erase(it);
+  }
+}
+
+// Calls that pass a plain pid share one cached descriptor per pid. Once that
+// process is gone the entry is dropped and the next call opens whatever
+// process holds the pid by then. Entries for other pids are swept whenever a
+// new one is opened and at most once a second otherwise.
+std::shared_ptr<ProcessMemory> process_for_pid(pid_t pid, std::string &error)
+{
+  std::lock_guard<std::mutex> lock(process_cache_mutex);
+  if (std::chrono::steady_clock::now() - process_cache_swept >= std::chrono::seconds(1))
+  {
+    sweep_process_cache();
+  }
+  auto it = process_cache.find(pid);
+  if (it != process_cache.end())
+  {
+    if (!it->second->exited)
+    {
+      return it->second;
+    }
+    process_cache.erase(it);
+  }
+
+  sweep_process_cache();
+  std::shared_ptr<ProcessMemory> proc = open_process_memory(pid, error);
+  if (proc)
+  {
+    process_cache[pid] = proc;
+  }
+  return proc;
+}
+
+class ProcessHandle : public Napi::ObjectWrap<ProcessHandle>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "ProcessHandle",
+                       {InstanceAccessor("pid", &ProcessHandle::get_pid, nullptr),
+                        InstanceMethod("alive", &ProcessHandle::alive),
+                        InstanceMethod("close", &ProcessHandle::close_handle)});
+  }
+
+  ProcessHandle(const Napi::CallbackInfo &info) : Napi::ObjectWrap<ProcessHandle>(info), pid(0)
+  {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return;
+    }
+
+    pid = info[0].As<Napi::Number>().Int32Value();
+    std::string error;
+    memory = open_process_memory(pid, error);
+    if (!memory)
+    {
+      Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    }
+  }
+
+  pid_t pid;
+  std::shared_ptr<ProcessMemory> memory;
+
+private:
+  Napi::Value get_pid(const Napi::CallbackInfo &info)
+  {
+    return Napi::Number::New(info.Env(), pid);
+  }
+
+  Napi::Value alive(const Napi::CallbackInfo &info)
+  {
+    return Napi::Boolean::New(info.Env(), memory && process_alive(*memory));
+  }
+
+  Napi::Value close_handle(const Napi::CallbackInfo &info)
+  {
+    memory.reset();
+    return info.Env().Null();
+  }
+};
+
+bool is_process_handle(const Napi::Value &value)
+{
+  if (!value.IsObject())
+  {
+    return false;
+  }
+  AddonData *data = value.Env().GetInstanceData<AddonData>();
+  return value.As<Napi::Object>().InstanceOf(data->process_handle.Value());
+}
+
+// Accepts a pid or a handle from open_process. Throws into JS and returns null
+// if the value is neither or the process cannot be opened.
+std::shared_ptr<ProcessMemory> get_process(Napi::Env env, const Napi::Value &value)
+{
+  std::string error;
+  std::shared_ptr<ProcessMemory> proc;
+
+  if (value.IsNumber())
+  {
+    proc = process_for_pid(value.As<Napi::Number>().Int32Value(), error);
+  }
+  else if (is_process_handle(value))
+  {
+    ProcessHandle *handle = ProcessHandle::Unwrap(value.As<Napi::Object>());
+    proc = handle->memory;
+    if (!proc)
+    {
+      error = "Process handle is closed";
+    }
+    else if (proc->exited)
+    {
+      error = "Process " + std::to_string(handle->pid) + " has exited";
+      proc = nullptr;
+    }
+  }
+  else
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+
+  if (!proc)
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+  }
+  return proc;
+}
+
+// Error for a failed read or write; names the exit if that is what happened.
+std::string access_error(const ProcessMemory &proc, const char *what, unsigned long long addr)
+{
+  std::stringstream ss;
+  if (proc.exited)
+  {
+    ss << "Process " << proc.pid << " has exited";
+  }
+  else
+  {
+    ss << "Failed to " << what << " memory at 0x" << std::hex << addr;
+  }
+  return ss.str();
+}
+
+// Addresses may be passed as a BigInt or as a non-negative integral Number.
+bool get_address(const Napi::Value &value, unsigned long long &addr)
+{
+  if (value.IsBigInt())
+  {
+    bool lossless;
+    addr = value.As<Napi::BigInt>().Uint64Value(&lossless);
+    return lossless;
+  }
+  if (value.IsNumber())
+  {
+    double number = value.As<Napi::Number>().DoubleValue();
+    if (number < 0 || number > 9007199254740992.0 || number != (double)(unsigned long long)number)
+    {
+      return false;
+    }
+    addr = (unsigned long long)number;
+    return true;
+  }
+  return false;
+}
+
+// Byte counts passed from JS: a non-negative integral Number no larger than
+// a Buffer can be. 4 GiB is the smallest buffer.kMaxLength of the Node
+// versions this builds for. Throws a RangeError into JS otherwise.
+const double max_buffer_length = 4294967296.0;
+
+bool get_length(Napi::Env env, const Napi::Value &value, size_t &len)
+{
+  double number = value.As<Napi::Number>().DoubleValue();
+  if (!(number >= 0 && number <= max_buffer_length) || number != (double)(size_t)number)
+  {
+    Napi::RangeError::New(env, "Length must be an integer between 0 and 4 GiB").ThrowAsJavaScriptException();
+    return false;
+  }
+  len = (size_t)number;
+  return true;
+}
+
+enum ValueType
+{
+  TYPE_I8,
+  TYPE_U8,
+  TYPE_I16,
+  TYPE_U16,
+  TYPE_I32,
+  TYPE_U32,
+  TYPE_I64,
+  TYPE_U64,
+  TYPE_F32,
+  TYPE_F64
+};
+
+bool parse_value_type(const std::string &name, ValueType &type)
+{
+  static const char *names[] = {"i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64"};
+  for (int i = 0; i <= TYPE_F64; ++i)
+  {
+    if (name == names[i])
+    {
+      type = static_cast<ValueType>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t value_type_size(ValueType type)
+{
+  switch (type)
+  {
+  case TYPE_I8:
+  case TYPE_U8:
+    return 1;
+  case TYPE_I16:
+  case TYPE_U16:
+    return 2;
+  case TYPE_I32:
+  case TYPE_U32:
+  case TYPE_F32:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+// 64-bit integers come back as BigInt, everything else as Number.
+Napi::Value value_to_js(Napi::Env env, ValueType type, const void *data)
+{
+  switch (type)
+  {
+  case TYPE_I8:
+    return Napi::Number::New(env, *(const int8_t *)data);
+  case TYPE_U8:
+    return Napi::Number::New(env, *(const uint8_t *)data);
+  case TYPE_I16:
+    return Napi::Number::New(env, *(const int16_t *)data);
+  case TYPE_U16:
+    return Napi::Number::New(env, *(const uint16_t *)data);
+  case TYPE_I32:
+    return Napi::Number::New(env, *(const int32_t *)data);
+  case TYPE_U32:
+    return Napi::Number::New(env, *(const uint32_t *)data);
+  case TYPE_I64:
+    return Napi::BigInt::New(env, *(const int64_t *)data);
+  case TYPE_U64:
+    return Napi::BigInt::New(env, *(const uint64_t *)data);
+  case TYPE_F32:
+    return Napi::Number::New(env, *(const float *)data);
+  default:
+    return Napi::Number::New(env, *(const double *)data);
+  }
+}
+
+// Like value_to_js, but always a double; 64-bit integers beyond 2^53 round.
+double value_to_number(ValueType type, const void *data)
+{
+  switch (type)
+  {
+  case TYPE_I8:
+    return *(const int8_t *)data;
+  case TYPE_U8:
+    return *(const uint8_t *)data;
+  case TYPE_I16:
+    return *(const int16_t *)data;
+  case TYPE_U16:
+    return *(const uint16_t *)data;
+  case TYPE_I32:
+    return *(const int32_t *)data;
+  case TYPE_U32:
+    return *(const uint32_t *)data;
+  case TYPE_I64:
+    return (double)*(const int64_t *)data;
+  case TYPE_U64:
+    return (double)*(const uint64_t *)data;
+  case TYPE_F32:
+    return *(const float *)data;
+  default:
+    return *(const double *)data;
+  }
+}
+
+// Converts a Number or BigInt to the in-memory representation of type.
+bool value_from_js(const Napi::Value &value, ValueType type, void *data)
+{
+  bool lossless;
+  int64_t integer;
+  double number = 0;
+
+  if (value.IsBigInt())
+  {
+    if (type == TYPE_U64)
+    {
+      *(uint64_t *)data = value.As<Napi::BigInt>().Uint64Value(&lossless);
+      return true;
+    }
+    integer = value.As<Napi::BigInt>().Int64Value(&lossless);
+    number = (double)integer;
+  }
+  else if (value.IsNumber())
+  {
+    number = value.As<Napi::Number>().DoubleValue();
+    integer = value.As<Napi::Number>().Int64Value();
+  }
+  else
+  {
+    return false;
+  }
+
+  switch (type)
+  {
+  case TYPE_I8:
+  case TYPE_U8:
+    *(uint8_t *)data = (uint8_t)integer;
+    break;
+  case TYPE_I16:
+  case TYPE_U16:
+    *(uint16_t *)data = (uint16_t)integer;
+    break;
+  case TYPE_I32:
+  case TYPE_U32:
+    *(uint32_t *)data = (uint32_t)integer;
+    break;
+  case TYPE_I64:
+  case TYPE_U64:
+    *(uint64_t *)data = (uint64_t)integer;
+    break;
+  case TYPE_F32:
+    *(float *)data = (float)number;
+    break;
+  case TYPE_F64:
+    *(double *)data = number;
+    break;
+  }
+  return true;
+}
+
+// Offsets may be negative, as a Number or a BigInt.
+bool get_offset(const Napi::Value &value, long long &offset)
+{
+  if (value.IsBigInt())
+  {
+    bool lossless;
+    offset = value.As<Napi::BigInt>().Int64Value(&lossless);
+    return lossless;
+  }
+  if (value.IsNumber())
+  {
+    offset = value.As<Napi::Number>().Int64Value();
+    return true;
+  }
+  return false;
+}
+
+struct PointerChain
+{
+  unsigned long long base;
+  std::vector<long long> offsets;
+  unsigned long long address;
+  bool ok;
+};
+
+bool get_pointer_chain(const Napi::Value &base, const Napi::Value &offsets, PointerChain &chain)
+{
+  if (!get_address(base, chain.base) || !offsets.IsArray())
+  {
+    return false;
+  }
+  Napi::Array list = offsets.As<Napi::Array>();
+  chain.offsets.resize(list.Length());
+  for (uint32_t i = 0; i < list.Length(); ++i)
+  {
+    if (!get_offset(list.Get(i), chain.offsets[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads a value of size bytes (at most 8) at each distinct address with a
+// single read_ranges call. values and ok line up with addresses.
+void read_distinct(ProcessMemory &proc, const std::vector<unsigned long long> &addresses, size_t size,
+                   std::vector<unsigned long long> &values, std::vector<unsigned char> &ok)
+{
+  std::unordered_map<unsigned long long, size_t> slots;
+  std::vector<size_t> slot_of(addresses.size());
+  std::vector<unsigned long long> unique;
+  for (size_t i = 0; i < addresses.size(); ++i)
+  {
+    auto it = slots.emplace(addresses[i], unique.size());
+    if (it.second)
+    {
+      unique.push_back(addresses[i]);
+    }
+    slot_of[i] = it.first->second;
+  }
+
+  std::vector<unsigned long long> unique_values(unique.size(), 0);
+  std::vector<unsigned char> unique_ok(unique.size());
+  std::vector<MemoryRange> ranges(unique.size());
+  for (size_t i = 0; i < unique.size(); ++i)
+  {
+    ranges[i].addr = unique[i];
+    ranges[i].buf = &unique_values[i];
+    ranges[i].len = size;
+  }
+  read_ranges(proc, ranges.data(), ranges.size(), unique_ok.data());
+
+  values.resize(addresses.size());
+  ok.resize(addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i)
+  {
+    values[i] = unique_values[slot_of[i]];
+    ok[i] = unique_ok[slot_of[i]];
+  }
+}
+
+// Follows [[base+o0]+o1]+...+on for every chain, one depth level at a time:
+// all dereferences of a level go out in one vectored read, and chains that
+// share a prefix read it only once.
+void resolve_pointer_chains(ProcessMemory &proc, std::vector<PointerChain> &chains, size_t pointer_size)
+{
+  size_t max_depth = 0;
+  for (PointerChain &chain : chains)
+  {
+    chain.address = chain.base;
+    chain.ok = true;
+    max_depth = std::max(max_depth, chain.offsets.size());
+  }
+
+  for (size_t depth = 0; depth + 1 < max_depth; ++depth)
+  {
+    std::vector<size_t> pending;
+    std::vector<unsigned long long> addresses;
+    for (size_t i = 0; i < chains.size(); ++i)
+    {
+      if (chains[i].ok && depth + 1 < chains[i].offsets.size())
+      {
+        pending.push_back(i);
+        addresses.push_back(chains[i].address + chains[i].offsets[depth]);
+      }
+    }
+
+    std::vector<unsigned long long> values;
+    std::vector<unsigned char> ok;
+    read_distinct(proc, addresses, pointer_size, values, ok);
+    for (size_t k = 0; k < pending.size(); ++k)
+    {
+      chains[pending[k]].address = values[k];
+      chains[pending[k]].ok = ok[k] && values[k] != 0;
+    }
+  }
+
+  for (PointerChain &chain : chains)
+  {
+    if (chain.ok && !chain.offsets.empty())
+    {
+      chain.address += chain.offsets.back();
+    }
+  }
+}
+
+// Options shared by the pointer chain exports: pointerSize (4 or 8, default
+// 8) and type, which returns the value at the final address instead.
+bool get_chain_options(const Napi::CallbackInfo &info, size_t index, size_t &pointer_size, bool &read_value, ValueType &type)
+{
+  pointer_size = 8;
+  read_value = false;
+  if (info.Length() <= index || info[index].IsUndefined())
+  {
+    return true;
+  }
+  if (!info[index].IsObject())
+  {
+    return false;
+  }
+
+  Napi::Object options = info[index].As<Napi::Object>();
+  if (options.Has("pointerSize"))
+  {
+    pointer_size = options.Get("pointerSize").ToNumber().Uint32Value();
+    if (pointer_size != 4 && pointer_size != 8)
+    {
+      return false;
+    }
+  }
+  if (options.Has("type"))
+  {
+    read_value = true;
+    return options.Get("type").IsString() && parse_value_type(options.Get("type").As<Napi::String>(), type);
+  }
+  return true;
+}
+
+// Converts resolved chains to JS: final addresses, or the values there when
+// a type was requested. Unresolvable chains become null.
+Napi::Array chain_results(Napi::Env env, ProcessMemory &proc, const std::vector<PointerChain> &chains, bool read_value, ValueType type)
+{
+  std::vector<unsigned long long> values;
+  std::vector<unsigned char> ok;
+  if (read_value)
+  {
+    std::vector<unsigned long long> addresses;
+    for (const PointerChain &chain : chains)
+    {
+      addresses.push_back(chain.address);
+    }
+    read_distinct(proc, addresses, value_type_size(type), values, ok);
+  }
+
+  Napi::Array result = Napi::Array::New(env, chains.size());
+  for (size_t i = 0; i < chains.size(); ++i)
+  {
+    if (!chains[i].ok || (read_value && !ok[i]))
+    {
+      result.Set(i, env.Null());
+    }
+    else if (read_value)
+    {
+      result.Set(i, value_to_js(env, type, &values[i]));
+    }
+    else
+    {
+      result.Set(i, Napi::BigInt::New(env, (uint64_t)chains[i].address));
+    }
+  }
+  return result;
+}
+
+// Region selection shared by list_regions and the scanners:
+//   perms   compared position by position, '?' matches anything ("r?x", "rw")
+//   module  file name or full path of the mapping
+//   start/end  only regions overlapping [start, end)
+struct RegionFilter
+{
+  std::string perms;
+  std::string module;
+  unsigned long long start;
+  unsigned long long end;
+
+  RegionFilter() : start(0), end(~0ULL) {}
+
+  bool matches(const MemoryRegion &region) const
+  {
+    for (size_t i = 0; i < perms.size() && i < 4; ++i)
+    {
+      if (perms[i] != '?' && perms[i] != region.perms[i])
+      {
+        return false;
+      }
+    }
+    if (!module.empty() && region.path != module && path_basename(region.path) != module)
+    {
+      return false;
+    }
+    return region.end > start && region.start < end;
+  }
+};
+
+bool get_region_filter(const Napi::Value &value, RegionFilter &filter)
+{
+  if (value.IsUndefined())
+  {
+    return true;
+  }
+  if (!value.IsObject())
+  {
+    return false;
+  }
+
+  Napi::Object options = value.As<Napi::Object>();
+  if (options.Has("perms"))
+  {
+    if (!options.Get("perms").IsString())
+    {
+      return false;
+    }
+    filter.perms = options.Get("perms").As<Napi::String>().Utf8Value();
+  }
+  if (options.Has("module"))
+  {
+    if (!options.Get("module").IsString())
+    {
+      return false;
+    }
+    filter.module = options.Get("module").As<Napi::String>().Utf8Value();
+  }
+  if (options.Has("start") && !get_address(options.Get("start"), filter.start))
+  {
+    return false;
+  }
+  if (options.Has("end") && !get_address(options.Get("end"), filter.end))
+  {
+    return false;
+  }
+  return true;
+}
+
+Napi::Object region_to_js(Napi::Env env, const MemoryRegion &region)
+{
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("start", Napi::BigInt::New(env, (uint64_t)region.start));
+  result.Set("end", Napi::BigInt::New(env, (uint64_t)region.end));
+  result.Set("perms", Napi::String::New(env, region.perms));
+  result.Set("offset", Napi::Number::New(env, region.offset));
+  result.Set("inode", Napi::Number::New(env, region.inode));
+  result.Set("path", Napi::String::New(env, region.path));
+  return result;
+}
+
+// A fixed set of native threads shared by the scanners. Threads are started
+// on first use and live for the rest of the process.
+class WorkerPool
+{
+public:
+  static WorkerPool &shared()
+  {
+    static WorkerPool *pool = new WorkerPool(std::max(1u, std::thread::hardware_concurrency()));
+    return *pool;
+  }
+
+  explicit WorkerPool(size_t count)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      threads.emplace_back([this]
+                           { run(); });
+    }
+  }
+
+  size_t size() const
+  {
+    return threads.size();
+  }
+
+  // Pins thread i to cpus[i % cpus.size()]; an empty list lets them float
+  // again. Returns 0, or the error of the last CPU the scheduler refused.
+  int pin(const std::vector<int> &cpus)
+  {
+    int error = 0;
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (cpus.empty())
+      {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+          CPU_SET(cpu, &set);
+        }
+      }
+      else
+      {
+        CPU_SET(cpus[i % cpus.size()], &set);
+      }
+      int result = pthread_setaffinity_np(threads[i].native_handle(), sizeof(set), &set);
+      error = result ? result : error;
+    }
+    return error;
+  }
+
+  // Calls fn(i) for every i in [0, count) on up to `workers` threads, the
+  // calling thread included, and returns once all calls have finished.
+  void parallel_for(size_t count, size_t workers, const std::function<void(size_t)> &fn)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->count = count;
+    job->fn = &fn;
+    job->export_id = current_export;
+
+    size_t helpers = std::min(std::min(workers, threads.size() + 1), count) - 1;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t i = 0; i < helpers; ++i)
+      {
+        queue.push_back(job);
+      }
+    }
+    wake.notify_all();
+
+    work(*job);
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&]
+                       { return job->done == job->count; });
+  }
+
+private:
+  struct Job
+  {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t count;
+    const std::function<void(size_t)> *fn;
+    int export_id;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  static void work(Job &job)
+  {
+    ExportScope scope(job.export_id);
+    size_t i;
+    while ((i = job.next++) < job.count)
+    {
+      (*job.fn)(i);
+      if (++job.done == job.count)
+      {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.finished.notify_all();
+      }
+    }
+  }
+
+  void run()
+  {
+    for (;;)
+    {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]
+                  { return !queue.empty(); });
+        job = queue.front();
+        queue.erase(queue.begin());
+      }
+      work(*job);
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<std::shared_ptr<Job>> queue;
+  std::mutex mutex;
+  std::condition_variable wake;
+};
+
+// One large read. Unlike read_ranges this returns how far the read got, so
+// callers can skip the page that stopped it and carry on.
+ssize_t read_span(ProcessMemory &proc, unsigned long long addr, void *buf, size_t len)
+{
+  if (proc.pidfd >= 0 && !vm_readv_unavailable)
+  {
+    struct iovec local = {buf, len};
+    struct iovec remote = {(void *)addr, len};
+    ssize_t n = process_vm_readv(proc.pid, &local, 1, &remote, 1, 0);
+    if (n >= 0 || errno == EFAULT)
+    {
+      count_bytes_read(n > 0 ? n : 0);
+      return n;
+    }
+    if (errno == ENOSYS)
+    {
+      vm_readv_unavailable = true;
+    }
+  }
+  return read_memory(proc, addr, buf, len);
+}
+
+Napi::Value open_process(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  AddonData *data = env.GetInstanceData<AddonData>();
+  return data->process_handle.New({info[0]});
+}
+
+// freeze()/thaw(): a ptrace session that stops every thread of a process, so
+// a batch of reads sees one consistent state. Reads never need it; they go
+// through process_vm_readv or /proc/<pid>/mem either way. ptrace ties each
+// tracee to the thread that seized it, so sessions live in the AddonData of
+// the JS thread that froze the process and only it can thaw them.
+
+std::vector<pid_t> list_threads(pid_t pid)
+{
+  std::vector<pid_t> tids;
+  std::string path = "/proc/" + std::to_string(pid) + "/task";
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+  {
+    return tids;
+  }
+  while (struct dirent *entry = readdir(dir))
+  {
+    if (entry->d_name[0] != '.')
+    {
+      tids.push_back(atoi(entry->d_name));
+    }
+  }
+  closedir(dir);
+  return tids;
+}
+
+// Seizes and stops one thread. Returns false with errno set if it could not
+// be seized; a thread that exits meanwhile counts as done, with tid 0.
+bool stop_tracee(pid_t &tid, int &signal)
+{
+  signal = 0;
+  if (ptrace(PTRACE_SEIZE, tid, NULL, NULL) != 0)
+  {
+    if (errno == ESRCH)
+    {
+      tid = 0;
+      return true;
+    }
+    return false;
+  }
+  ptrace(PTRACE_INTERRUPT, tid, NULL, NULL);
+
+  int status;
+  if (waitpid(tid, &status, __WALL) != tid || !WIFSTOPPED(status))
+  {
+    tid = 0;
+    return true;
+  }
+  // Anything but the interrupt's event stop is a signal delivery stop; the
+  // thread is stopped all the same, but the signal must not be lost.
+  if (status >> 16 != PTRACE_EVENT_STOP)
+  {
+    signal = WSTOPSIG(status);
+  }
+  return true;
+}
+
+// Lets every thread of session run again. Returns 0, or the error of the
+// last thread that could not be detached; threads that exited meanwhile do
+// not count.
+int release_threads(FreezeSession &session, pid_t &failed_tid)
+{
+  int error = 0;
+  for (const auto &thread : session.threads)
+  {
+    if (ptrace(PTRACE_DETACH, thread.first, NULL, (void *)(long)thread.second) != 0 && errno != ESRCH)
+    {
+      error = errno;
+      failed_tid = thread.first;
+    }
+  }
+  session.threads.clear();
+  return error;
+}
+
+// freeze(pid) stops every thread of the process until the matching thaw.
+// Threads started while freezing are caught by listing the tasks again until
+// no new ones show up. Calls nest; returns the number of threads stopped.
+Napi::Value freeze(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  std::unordered_map<pid_t, FreezeSession> &freeze_sessions = env.GetInstanceData<AddonData>()->freeze_sessions;
+  auto existing = freeze_sessions.find(proc->pid);
+  if (existing != freeze_sessions.end())
+  {
+    existing->second.depth++;
+    return Napi::Number::New(env, existing->second.threads.size());
+  }
+
+  FreezeSession session;
+  session.depth = 1;
+  std::vector<pid_t> stopped;
+  for (bool found_new = true; found_new;)
+  {
+    found_new = false;
+    for (pid_t tid : list_threads(proc->pid))
+    {
+      if (std::find(stopped.begin(), stopped.end(), tid) != stopped.end())
+      {
+        continue;
+      }
+      stopped.push_back(tid);
+      found_new = true;
+
+      int signal;
+      pid_t stopped_tid = tid;
+      if (!stop_tracee(stopped_tid, signal))
+      {
+        int error = errno;
+        pid_t failed_tid;
+        release_threads(session, failed_tid);
+        Napi::Error::New(env, "Could not freeze thread " + std::to_string(tid) + " of process " + std::to_string(proc->pid) + ": " +
+                                  strerror(error))
+            .ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      if (stopped_tid)
+      {
+        session.threads.push_back(std::make_pair(stopped_tid, signal));
+      }
+    }
+  }
+
+  if (session.threads.empty())
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = session.threads.size();
+  freeze_sessions[proc->pid] = session;
+  return Napi::Number::New(env, count);
+}
+
+// thaw(pid) ends one freeze; the threads run again once every freeze of the
+// process has been thawed. Returns whether they are running.
+Napi::Value thaw(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t pid;
+  if (info[0].IsNumber())
+  {
+    pid = info[0].As<Napi::Number>().Int32Value();
+  }
+  else if (is_process_handle(info[0]))
+  {
+    pid = ProcessHandle::Unwrap(info[0].As<Napi::Object>())->pid;
+  }
+  else
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::unordered_map<pid_t, FreezeSession> &freeze_sessions = env.GetInstanceData<AddonData>()->freeze_sessions;
+  auto session = freeze_sessions.find(pid);
+  if (session == freeze_sessions.end())
+  {
+    return Napi::Boolean::New(env, true);
+  }
+  if (--session->second.depth > 0)
+  {
+    return Napi::Boolean::New(env, false);
+  }
+  pid_t failed_tid = 0;
+  int error = release_threads(session->second, failed_tid);
+  freeze_sessions.erase(session);
+  if (error)
+  {
+    Napi::Error::New(env, "Could not thaw thread " + std::to_string(failed_tid) + " of process " + std::to_string(pid) + ": " +
+                              strerror(error))
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value read_integer(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  if (!get_address(info[1], addr))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  int value;
+  if (read_memory(*proc, addr, &value, sizeof(value)) != sizeof(value))
+  {
+    Napi::Error::New(env, access_error(*proc, "read", addr)).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Number::New(env, value);
+}
+Napi::Value write_integer(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  if (!get_address(info[1], addr) || !info[2].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  int value = info[2].As<Napi::Number>().Int32Value();
+
+  if (!proc->writable)
+  {
+    Napi::Error::New(env, "Process memory is not writable").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ssize_t written = write_memory(*proc, addr, &value, sizeof(value));
+
+  if (written != sizeof(value))
+  {
+    Napi::Error::New(env, access_error(*proc, "write", addr)).ThrowAsJavaScriptException();
+  }
+  return env.Null();
+}
+// Parses the (pid, addresses, sizes) arguments of read_batch into ranges
+// without destinations; total is the packed size of all of them. Throws into
+// JS and returns false if an argument has the wrong type, or a size, or the
+// total, is not a valid Buffer length.
+bool get_batch_ranges(const Napi::CallbackInfo &info, std::vector<MemoryRange> &ranges, size_t &total)
+{
+  Napi::Env env = info.Env();
+  if (!info[1].IsArray() || !(info[2].IsArray() || info[2].IsNumber()))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Array addresses = info[1].As<Napi::Array>();
+  uint32_t count = addresses.Length();
+  ranges.resize(count);
+  total = 0;
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    Napi::Value size = info[2].IsArray() ? info[2].As<Napi::Array>().Get(i) : info[2];
+    if (!get_address(addresses.Get(i), ranges[i].addr) || !size.IsNumber())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return false;
+    }
+    if (!get_length(env, size, ranges[i].len))
+    {
+      return false;
+    }
+    total += ranges[i].len;
+    if (total > max_buffer_length)
+    {
+      Napi::RangeError::New(env, "Total length must be at most 4 GiB").ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+  return true;
+}
+
+// Points the ranges at consecutive slices of data, in request order.
+void place_batch_ranges(std::vector<MemoryRange> &ranges, unsigned char *data)
+{
+  size_t offset = 0;
+  for (MemoryRange &range : ranges)
+  {
+    range.buf = data + offset;
+    offset += range.len;
+  }
+}
+
+Napi::Object batch_result(Napi::Env env, Napi::Buffer<unsigned char> data, const std::vector<MemoryRange> &ranges,
+                          const std::vector<unsigned char> &ok)
+{
+  Napi::Array failed = Napi::Array::New(env);
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    if (!ok[i])
+    {
+      std::memset(ranges[i].buf, 0, ranges[i].len);
+      failed.Set(failed.Length(), Napi::Number::New(env, i));
+    }
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("data", data);
+  result.Set("failed", failed);
+  return result;
+}
+
+Napi::Value read_batch(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<MemoryRange> ranges;
+  size_t total;
+  if (!get_batch_ranges(info, ranges, total))
+  {
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  // Values are read straight into the returned buffer, packed in request order.
+  Napi::Buffer<unsigned char> data = Napi::Buffer<unsigned char>::New(env, total);
+  place_batch_ranges(ranges, data.Data());
+
+  std::vector<unsigned char> ok(ranges.size());
+  read_ranges(*proc, ranges.data(), ranges.size(), ok.data());
+  return batch_result(env, data, ranges, ok);
+}
+
+Napi::Value write_batch(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[1].IsArray())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  // Each entry is {address, data}; data is a Buffer/TypedArray or a number
+  // written as a 32-bit integer like write_integer does.
+  Napi::Array entries = info[1].As<Napi::Array>();
+  uint32_t count = entries.Length();
+  std::vector<MemoryRange> ranges(count);
+  std::vector<int> integers(count);
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    Napi::Value entry = entries.Get(i);
+    if (!entry.IsObject())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    Napi::Value data = entry.As<Napi::Object>().Get("data");
+    if (!get_address(entry.As<Napi::Object>().Get("address"), ranges[i].addr) ||
+        !(data.IsTypedArray() || data.IsNumber()))
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    if (data.IsNumber())
+    {
+      integers[i] = data.As<Napi::Number>().Int32Value();
+      ranges[i].buf = &integers[i];
+      ranges[i].len = sizeof(int);
+    }
+    else
+    {
+      Napi::TypedArray bytes = data.As<Napi::TypedArray>();
+      ranges[i].buf = static_cast<unsigned char *>(bytes.ArrayBuffer().Data()) + bytes.ByteOffset();
+      ranges[i].len = bytes.ByteLength();
+    }
+  }
+
+  std::vector<unsigned char> ok(count);
+  size_t written = write_ranges(*proc, ranges.data(), count, ok.data());
+
+  Napi::Array failed = Napi::Array::New(env);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (!ok[i])
+    {
+      failed.Set(failed.Length(), Napi::Number::New(env, i));
+    }
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("written", Napi::Number::New(env, written));
+  result.Set("failed", failed);
+  return result;
+}
+
+template <ValueType type>
+Napi::Value read_value(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  if (!get_address(info[1], addr))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  unsigned char buf[8];
+  ssize_t size = value_type_size(type);
+  if (read_memory(*proc, addr, buf, size) != size)
+  {
+    Napi::Error::New(env, access_error(*proc, "read", addr)).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return value_to_js(env, type, buf);
+}
+
+template <ValueType type>
+Napi::Value write_value(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  unsigned char buf[8];
+  if (!get_address(info[1], addr) || !value_from_js(info[2], type, buf))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  MemoryRange range = {addr, buf, value_type_size(type)};
+  unsigned char ok;
+  write_ranges(*proc, &range, 1, &ok);
+  if (!ok)
+  {
+    Napi::Error::New(env, access_error(*proc, "write", addr)).ThrowAsJavaScriptException();
+  }
+  return env.Null();
+}
+
+// read_bytes(pid, address, length[, target]) reads straight into target (a
+// Buffer or TypedArray at least length bytes long) when one is given and
+// returns it, otherwise into a new Buffer.
+Napi::Value read_bytes(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  bool has_target = info.Length() > 3 && !info[3].IsUndefined();
+  if (!get_address(info[1], addr) || !info[2].IsNumber() || (has_target && !info[3].IsTypedArray()))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t len;
+  if (!get_length(env, info[2], len))
+  {
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  Napi::Value result;
+  unsigned char *dst;
+  if (has_target)
+  {
+    Napi::TypedArray target = info[3].As<Napi::TypedArray>();
+    if (target.ByteLength() < len)
+    {
+      Napi::RangeError::New(env, "Target buffer is too small").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    dst = static_cast<unsigned char *>(target.ArrayBuffer().Data()) + target.ByteOffset();
+    result = target;
+  }
+  else
+  {
+    Napi::Buffer<unsigned char> buffer = Napi::Buffer<unsigned char>::New(env, len);
+    dst = buffer.Data();
+    result = buffer;
+  }
+
+  if (read_memory(*proc, addr, dst, len) != (ssize_t)len)
+  {
+    Napi::Error::New(env, access_error(*proc, "read", addr)).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return result;
+}
+
+Napi::Value write_bytes(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  if (!get_address(info[1], addr) || !info[2].IsTypedArray())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  Napi::TypedArray bytes = info[2].As<Napi::TypedArray>();
+  MemoryRange range = {addr, static_cast<unsigned char *>(bytes.ArrayBuffer().Data()) + bytes.ByteOffset(), bytes.ByteLength()};
+  unsigned char ok;
+  write_ranges(*proc, &range, 1, &ok);
+  if (!ok)
+  {
+    Napi::Error::New(env, access_error(*proc, "write", addr)).ThrowAsJavaScriptException();
+  }
+  return env.Null();
+}
+
+Napi::Value resolve_pointer_chain(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<PointerChain> chains(1);
+  size_t pointer_size;
+  bool read_value;
+  ValueType type;
+  if (!get_pointer_chain(info[1], info[2], chains[0]) || !get_chain_options(info, 3, pointer_size, read_value, type))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  resolve_pointer_chains(*proc, chains, pointer_size);
+  return chain_results(env, *proc, chains, read_value, type).Get((uint32_t)0);
+}
+
+// resolve_pointer_chains(pid, [{base, offsets}, ...], options) resolves all
+// chains together, see resolve_pointer_chains above.
+Napi::Value resolve_pointer_chains_batch(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t pointer_size;
+  bool read_value;
+  ValueType type;
+  if (!info[1].IsArray() || !get_chain_options(info, 2, pointer_size, read_value, type))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array list = info[1].As<Napi::Array>();
+  std::vector<PointerChain> chains(list.Length());
+  for (uint32_t i = 0; i < list.Length(); ++i)
+  {
+    Napi::Value entry = list.Get(i);
+    if (!entry.IsObject() ||
+        !get_pointer_chain(entry.As<Napi::Object>().Get("base"), entry.As<Napi::Object>().Get("offsets"), chains[i]))
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  resolve_pointer_chains(*proc, chains, pointer_size);
+  return chain_results(env, *proc, chains, read_value, type);
+}
+
+// A struct layout from define_struct: named fields at fixed offsets. "ptr"
+// fields are read as u64.
+struct StructField
+{
+  std::string name;
+  ValueType type;
+  size_t offset;
+};
+
+class StructLayout : public Napi::ObjectWrap<StructLayout>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "StructLayout",
+                       {InstanceAccessor("size", &StructLayout::get_size, nullptr),
+                        InstanceAccessor("fields", &StructLayout::get_fields, nullptr)});
+  }
+
+  StructLayout(const Napi::CallbackInfo &info) : Napi::ObjectWrap<StructLayout>(info), size(0) {}
+
+  std::vector<StructField> fields;
+  size_t size;
+
+private:
+  Napi::Value get_size(const Napi::CallbackInfo &info)
+  {
+    return Napi::Number::New(info.Env(), size);
+  }
+
+  Napi::Value get_fields(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Array names = Napi::Array::New(env, fields.size());
+    for (size_t i = 0; i < fields.size(); ++i)
+    {
+      names.Set(i, Napi::String::New(env, fields[i].name));
+    }
+    return names;
+  }
+};
+
+StructLayout *get_struct_layout(const Napi::Value &value)
+{
+  AddonData *data = value.Env().GetInstanceData<AddonData>();
+  if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(data->struct_layout.Value()))
+  {
+    return nullptr;
+  }
+  return StructLayout::Unwrap(value.As<Napi::Object>());
+}
+
+// Decodes one struct into a plain object. keys holds the field names,
+// created once per call rather than once per object.
+Napi::Object struct_to_js(Napi::Env env, const StructLayout &layout, const std::vector<Napi::String> &keys, const unsigned char *data)
+{
+  Napi::Object object = Napi::Object::New(env);
+  for (size_t i = 0; i < layout.fields.size(); ++i)
+  {
+    object.Set(keys[i], value_to_js(env, layout.fields[i].type, data + layout.fields[i].offset));
+  }
+  return object;
+}
+
+std::vector<Napi::String> struct_keys(Napi::Env env, const StructLayout &layout)
+{
+  std::vector<Napi::String> keys;
+  for (const StructField &field : layout.fields)
+  {
+    keys.push_back(Napi::String::New(env, field.name));
+  }
+  return keys;
+}
+
+// define_struct({ name: [type, offset], ... }) compiles a layout for
+// read_struct and read_struct_array. type is any read_<type> suffix or "ptr".
+Napi::Value define_struct(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsObject())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object spec = info[0].As<Napi::Object>();
+  Napi::Array names = spec.GetPropertyNames();
+  std::vector<StructField> fields;
+  size_t size = 0;
+  for (uint32_t i = 0; i < names.Length(); ++i)
+  {
+    Napi::Value name = names.Get(i);
+    Napi::Value entry = spec.Get(name);
+    StructField field;
+    field.name = name.ToString().Utf8Value();
+    if (!entry.IsArray() || entry.As<Napi::Array>().Length() < 2 || !entry.As<Napi::Array>().Get((uint32_t)0).IsString() ||
+        !entry.As<Napi::Array>().Get(1).IsNumber())
+    {
+      Napi::TypeError::New(env, "Field " + field.name + " must be [type, offset]").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    std::string type = entry.As<Napi::Array>().Get((uint32_t)0).As<Napi::String>().Utf8Value();
+    if (type == "ptr")
+    {
+      field.type = TYPE_U64;
+    }
+    else if (!parse_value_type(type, field.type))
+    {
+      Napi::TypeError::New(env, "Unknown type " + type + " for field " + field.name).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    int64_t offset = entry.As<Napi::Array>().Get(1).As<Napi::Number>().Int64Value();
+    if (offset < 0 || offset > (1 << 24))
+    {
+      Napi::RangeError::New(env, "Offset out of range for field " + field.name).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    field.offset = offset;
+    size = std::max(size, field.offset + value_type_size(field.type));
+    fields.push_back(field);
+  }
+
+  Napi::Object handle = env.GetInstanceData<AddonData>()->struct_layout.New({});
+  StructLayout *layout = StructLayout::Unwrap(handle);
+  layout->fields = fields;
+  layout->size = size;
+  return handle;
+}
+
+// read_struct(pid, address, layout) reads the struct in one piece and
+// returns it as a plain object.
+Napi::Value read_struct(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  StructLayout *layout = get_struct_layout(info[2]);
+  if (!get_address(info[1], addr) || !layout)
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  std::vector<unsigned char> buf(layout->size);
+  if (read_span(*proc, addr, buf.data(), buf.size()) != (ssize_t)buf.size())
+  {
+    Napi::Error::New(env, access_error(*proc, "read", addr)).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return struct_to_js(env, *layout, struct_keys(env, *layout), buf.data());
+}
+
+// A typed array of count elements matching type, and where its data starts.
+Napi::TypedArray column_array(Napi::Env env, ValueType type, size_t count, unsigned char *&data)
+{
+  switch (type)
+  {
+  case TYPE_I8:
+  {
+    Napi::Int8Array array = Napi::Int8Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_U8:
+  {
+    Napi::Uint8Array array = Napi::Uint8Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_I16:
+  {
+    Napi::Int16Array array = Napi::Int16Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_U16:
+  {
+    Napi::Uint16Array array = Napi::Uint16Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_I32:
+  {
+    Napi::Int32Array array = Napi::Int32Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_U32:
+  {
+    Napi::Uint32Array array = Napi::Uint32Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_I64:
+  {
+    Napi::BigInt64Array array = Napi::BigInt64Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_U64:
+  {
+    Napi::BigUint64Array array = Napi::BigUint64Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  case TYPE_F32:
+  {
+    Napi::Float32Array array = Napi::Float32Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  default:
+  {
+    Napi::Float64Array array = Napi::Float64Array::New(env, count);
+    data = (unsigned char *)array.Data();
+    return array;
+  }
+  }
+}
+
+// read_struct_array(pid, address, count, stride, layout, options) reads count
+// structs stride bytes apart (the layout's size if stride is 0) in one read
+// and returns an array of objects, null where a struct could not be read.
+// With options.columnar it returns { field: TypedArray, ..., valid:
+// Uint8Array } instead, one typed array per field.
+Napi::Value read_struct_array(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 5)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  StructLayout *layout = get_struct_layout(info[4]);
+  if (!get_address(info[1], addr) || !info[2].IsNumber() || !info[3].IsNumber() || !layout)
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool columnar = info[5].IsObject() && info[5].As<Napi::Object>().Get("columnar").ToBoolean();
+  // The whole array is read into one buffer, so count and stride are held
+  // to what that buffer can sensibly be.
+  const double max_span = 1 << 30;
+  double count_value = info[2].As<Napi::Number>().DoubleValue();
+  double stride_value = info[3].As<Napi::Number>().DoubleValue();
+  if (stride_value == 0)
+  {
+    stride_value = layout->size;
+  }
+  if (!(count_value >= 0 && count_value <= max_span && stride_value >= 0 && stride_value <= max_span) ||
+      (count_value > 0 && (count_value - 1) * stride_value + layout->size > max_span))
+  {
+    Napi::RangeError::New(env, "count and stride must be non-negative and span at most 1 GiB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = count_value;
+  size_t stride = stride_value;
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  // One read for the whole array; if any of it is unreadable, one range
+  // per struct so the readable ones still come back.
+  size_t span = count ? (count - 1) * stride + layout->size : 0;
+  std::vector<unsigned char> buf(span);
+  std::vector<unsigned char> ok(count, 1);
+  if (count && read_span(*proc, addr, buf.data(), span) != (ssize_t)span)
+  {
+    std::vector<MemoryRange> ranges(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      ranges[i] = {addr + i * stride, buf.data() + i * stride, layout->size};
+    }
+    read_ranges(*proc, ranges.data(), count, ok.data());
+  }
+
+  if (!columnar)
+  {
+    std::vector<Napi::String> keys = struct_keys(env, *layout);
+    Napi::Array result = Napi::Array::New(env, count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      result.Set(i, ok[i] ? (Napi::Value)struct_to_js(env, *layout, keys, buf.data() + i * stride) : env.Null());
+    }
+    return result;
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  for (const StructField &field : layout->fields)
+  {
+    unsigned char *column;
+    Napi::TypedArray array = column_array(env, field.type, count, column);
+    size_t size = value_type_size(field.type);
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (ok[i])
+      {
+        memcpy(column + i * size, buf.data() + i * stride + field.offset, size);
+      }
+    }
+    result.Set(field.name, array);
+  }
+  Napi::Uint8Array valid = Napi::Uint8Array::New(env, count);
+  if (count)
+  {
+    memcpy(valid.Data(), ok.data(), count);
+  }
+  result.Set("valid", valid);
+  return result;
+}
+
+// The maps exports take a pid or a process handle. Throws into JS and
+// returns null if the process cannot be found.
+std::shared_ptr<const ProcessMaps> get_process_maps(Napi::Env env, const Napi::Value &value, MapsCheck check)
+{
+  std::shared_ptr<ProcessMemory> proc = get_process(env, value);
+  if (!proc)
+  {
+    return nullptr;
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_maps(proc->pid, check);
+  if (maps && maps->start_time != proc->start_time && check == MAPS_CACHED)
+  {
+    // A table trusted without a check can belong to an earlier owner of the pid.
+    maps = get_maps(proc->pid, MAPS_CHECKED);
+  }
+  if (!maps || maps->start_time != proc->start_time)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return maps;
+}
+
+Napi::Value get_module_base(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[1].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CACHED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  std::string module = info[1].As<Napi::String>().Utf8Value();
+  auto it = maps->module_bases.find(module);
+  if (it == maps->module_bases.end())
+  {
+    // The module may have been loaded since the table was last checked.
+    maps = get_process_maps(env, info[0], MAPS_CHECKED);
+    if (!maps)
+    {
+      return env.Null();
+    }
+    it = maps->module_bases.find(module);
+  }
+  if (it == maps->module_bases.end())
+  {
+    return env.Null();
+  }
+  return Napi::BigInt::New(env, (uint64_t)it->second);
+}
+
+Napi::Value find_region(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  if (!get_address(info[1], addr))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CACHED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  const MemoryRegion *region = maps->find(addr);
+  if (!region)
+  {
+    maps = get_process_maps(env, info[0], MAPS_CHECKED);
+    if (!maps)
+    {
+      return env.Null();
+    }
+    region = maps->find(addr);
+  }
+  if (!region)
+  {
+    return env.Null();
+  }
+  return region_to_js(env, *region);
+}
+
+Napi::Value list_regions(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RegionFilter filter;
+  if (!get_region_filter(info[1], filter))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  Napi::Array result = Napi::Array::New(env);
+  for (const MemoryRegion &region : maps->regions)
+  {
+    if (filter.matches(region))
+    {
+      result.Set(result.Length(), region_to_js(env, region));
+    }
+  }
+  return result;
+}
+
+Napi::Value refresh_maps(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_RELOAD);
+  if (!maps)
+  {
+    return env.Null();
+  }
+  return Napi::Number::New(env, maps->regions.size());
+}
+
+// Symbol tables of mapped ELF modules, for resolve_symbol() and symbolize().
+// A module's .symtab and .dynsym (or, when the section headers are stripped,
+// the dynamic symbols found through PT_DYNAMIC and the hash tables) are
+// flattened into an index: a header, the symbols sorted by address, their
+// indices sorted by name and the names. The same bytes are kept in memory
+// and written to the cache directory under the module's build-id, so a later
+// run maps the file instead of parsing the ELF again.
+struct SymbolIndexHeader
+{
+  char magic[8];
+  uint64_t count;
+  uint64_t strings_size;
+  uint64_t reserved;
+};
+
+struct SymbolEntry
+{
+  uint64_t value;
+  uint64_t size;
+  uint32_t name;
+  uint32_t info;
+};
+
+const char symbol_index_magic[8] = {'R', 'M', 'S', 'Y', 'M', 'S', '1', 0};
+
+class SymbolTable
+{
+public:
+  ~SymbolTable()
+  {
+    if (mapped)
+    {
+      munmap(mapped, mapped_size);
+    }
+  }
+
+  // Points the table at an index, checking that it is complete and that
+  // every name-order slot indexes an entry, since find() follows them
+  // unchecked and the file may be truncated or corrupted on disk.
+  bool attach(const unsigned char *data, size_t size)
+  {
+    if (size < sizeof(SymbolIndexHeader))
+    {
+      return false;
+    }
+    header = reinterpret_cast<const SymbolIndexHeader *>(data);
+    if (memcmp(header->magic, symbol_index_magic, 8) != 0 || header->count > size / sizeof(SymbolEntry) ||
+        header->strings_size > size ||
+        sizeof(SymbolIndexHeader) + header->count * (sizeof(SymbolEntry) + 4) + header->strings_size != size)
+    {
+      return false;
+    }
+    entries = reinterpret_cast<const SymbolEntry *>(data + sizeof(SymbolIndexHeader));
+    by_name = reinterpret_cast<const uint32_t *>(entries + header->count);
+    strings = reinterpret_cast<const char *>(by_name + header->count);
+    for (uint64_t i = 0; i < header->count; ++i)
+    {
+      if (by_name[i] >= header->count)
+      {
+        return false;
+      }
+    }
+    return header->strings_size > 0 && strings[header->strings_size - 1] == 0;
+  }
+
+  bool load(const std::string &file)
+  {
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      return false;
+    }
+    struct stat st;
+    void *data = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+      return false;
+    }
+    mapped = data;
+    mapped_size = st.st_size;
+    return attach((const unsigned char *)data, st.st_size);
+  }
+
+  const char *name(const SymbolEntry &entry) const
+  {
+    return entry.name < header->strings_size ? strings + entry.name : "";
+  }
+
+  const SymbolEntry *find(const std::string &symbol) const
+  {
+    const uint32_t *end = by_name + header->count;
+    const uint32_t *it = std::lower_bound(by_name, end, symbol, [this](uint32_t index, const std::string &wanted)
+                                          { return strcmp(name(entries[index]), wanted.c_str()) < 0; });
+    return it != end && symbol == name(entries[*it]) ? &entries[*it] : nullptr;
+  }
+
+  // The symbol covering vaddr, or the closest one before it when it has no
+  // size. Null if vaddr is past the end of a sized symbol.
+  const SymbolEntry *containing(uint64_t vaddr) const
+  {
+    const SymbolEntry *end = entries + header->count;
+    const SymbolEntry *it = std::upper_bound(entries, end, vaddr, [](uint64_t a, const SymbolEntry &entry)
+                                             { return a < entry.value; });
+    if (it == entries)
+    {
+      return nullptr;
+    }
+    --it;
+    return it->size == 0 || vaddr < it->value + it->size ? it : nullptr;
+  }
+
+  std::vector<unsigned char> owned;
+
+private:
+  void *mapped = nullptr;
+  size_t mapped_size = 0;
+  const SymbolIndexHeader *header = nullptr;
+  const SymbolEntry *entries = nullptr;
+  const uint32_t *by_name = nullptr;
+  const char *strings = nullptr;
+};
+
+// A module file mapped read-only, with what is needed to find and place its
+// symbols: the identity used as cache key and the load address of its first
+// PT_LOAD segment relative to its file offset.
+struct ElfModule
+{
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+  std::string key;
+  bool has_build_id = false;
+  uint64_t first_load = 0;
+
+  ~ElfModule()
+  {
+    if (data)
+    {
+      munmap((void *)data, size);
+    }
+  }
+
+  template <typename T>
+  const T *at(uint64_t offset, uint64_t count = 1) const
+  {
+    return offset <= size && count <= (size - offset) / sizeof(T) ? reinterpret_cast<const T *>(data + offset) : nullptr;
+  }
+
+  const Elf64_Ehdr *ehdr() const
+  {
+    return at<Elf64_Ehdr>(0);
+  }
+
+  const Elf64_Phdr *phdrs() const
+  {
+    return at<Elf64_Phdr>(ehdr()->e_phoff, ehdr()->e_phnum);
+  }
+
+  // File offset of a virtual address, through the PT_LOAD segments.
+  bool vaddr_offset(uint64_t vaddr, uint64_t &offset) const
+  {
+    const Elf64_Phdr *phdr = phdrs();
+    for (int i = 0; phdr && i < ehdr()->e_phnum; ++i)
+    {
+      if (phdr[i].p_type == PT_LOAD && vaddr >= phdr[i].p_vaddr && vaddr - phdr[i].p_vaddr < phdr[i].p_filesz)
+      {
+        offset = phdr[i].p_offset + (vaddr - phdr[i].p_vaddr);
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+bool open_elf_module(const std::string &file, ElfModule &module, std::string &error)
+{
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    error = "Could not open " + file + ": " + strerror(errno);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return false;
+  }
+  void *data = st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    error = "Could not map " + file;
+    return false;
+  }
+  module.data = (const unsigned char *)data;
+  module.size = st.st_size;
+
+  const Elf64_Ehdr *ehdr = module.ehdr();
+  if (!ehdr || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+      ehdr->e_ident[EI_DATA] != ELFDATA2LSB || ehdr->e_phentsize != sizeof(Elf64_Phdr) || !module.phdrs())
+  {
+    error = file + " is not a 64-bit little-endian ELF file";
+    return false;
+  }
+
+  const Elf64_Phdr *phdr = module.phdrs();
+  bool found_load = false;
+  for (int i = 0; i < ehdr->e_phnum; ++i)
+  {
+    if (phdr[i].p_type == PT_LOAD && !found_load)
+    {
+      module.first_load = phdr[i].p_vaddr - phdr[i].p_offset;
+      found_load = true;
+    }
+    // NT_GNU_BUILD_ID notes: namesz 4 ("GNU\0"), the id as descriptor.
+    for (uint64_t offset = phdr[i].p_offset; phdr[i].p_type == PT_NOTE && !module.has_build_id;)
+    {
+      const Elf64_Nhdr *note = module.at<Elf64_Nhdr>(offset);
+      if (!note || offset + sizeof(Elf64_Nhdr) > phdr[i].p_offset + phdr[i].p_filesz)
+      {
+        break;
+      }
+      uint64_t name_at = offset + sizeof(Elf64_Nhdr);
+      uint64_t desc_at = name_at + ((note->n_namesz + 3) & ~3ULL);
+      if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && module.at<char>(name_at, 4) &&
+          memcmp(module.data + name_at, "GNU", 4) == 0 && module.at<unsigned char>(desc_at, note->n_descsz))
+      {
+        static const char hex[] = "0123456789abcdef";
+        for (uint32_t k = 0; k < note->n_descsz; ++k)
+        {
+          module.key += hex[module.data[desc_at + k] >> 4];
+          module.key += hex[module.data[desc_at + k] & 15];
+        }
+        module.has_build_id = !module.key.empty();
+      }
+      offset = desc_at + ((note->n_descsz + 3) & ~3ULL);
+    }
+  }
+  if (!module.has_build_id)
+  {
+    std::stringstream key;
+    key << st.st_dev << ":" << st.st_ino << ":" << st.st_size << ":" << st.st_mtime;
+    module.key = key.str();
+  }
+  return true;
+}
+
+struct ParsedSymbol
+{
+  const char *name;
+  uint64_t value;
+  uint64_t size;
+  uint32_t info;
+};
+
+void collect_symbols(const ElfModule &module, const Elf64_Sym *symbols, uint64_t count, const char *names, uint64_t names_size,
+                     std::vector<ParsedSymbol> &out)
+{
+  for (uint64_t i = 0; symbols && names && i < count; ++i)
+  {
+    const Elf64_Sym &symbol = symbols[i];
+    int type = ELF64_ST_TYPE(symbol.st_info);
+    if (symbol.st_name == 0 || symbol.st_name >= names_size || symbol.st_shndx == SHN_UNDEF ||
+        (type != STT_FUNC && type != STT_OBJECT && type != STT_GNU_IFUNC))
+    {
+      continue;
+    }
+    const char *name = names + symbol.st_name;
+    if (!memchr(name, 0, names_size - symbol.st_name))
+    {
+      continue;
+    }
+    out.push_back({name, symbol.st_value, symbol.st_size, symbol.st_info});
+  }
+}
+
+// Number of .dynsym entries from DT_GNU_HASH: one past the last symbol any
+// hash chain reaches.
+uint64_t gnu_hash_symbol_count(const ElfModule &module, uint64_t offset)
+{
+  const uint32_t *table = module.at<uint32_t>(offset, 4);
+  if (!table)
+  {
+    return 0;
+  }
+  uint32_t buckets_count = table[0];
+  uint32_t symbol_offset = table[1];
+  uint64_t buckets_at = offset + 16 + (uint64_t)table[2] * 8;
+  const uint32_t *buckets = module.at<uint32_t>(buckets_at, buckets_count);
+  if (!buckets)
+  {
+    return 0;
+  }
+  uint32_t last = 0;
+  for (uint32_t i = 0; i < buckets_count; ++i)
+  {
+    last = std::max(last, buckets[i]);
+  }
+  if (last < symbol_offset)
+  {
+    return symbol_offset;
+  }
+  uint64_t chains_at = buckets_at + (uint64_t)buckets_count * 4;
+  for (;; ++last)
+  {
+    const uint32_t *chain = module.at<uint32_t>(chains_at + (uint64_t)(last - symbol_offset) * 4);
+    if (!chain || (*chain & 1))
+    {
+      return last + 1;
+    }
+  }
+}
+
+// Dynamic symbols of a module without section headers.
+void collect_dynamic_symbols(const ElfModule &module, std::vector<ParsedSymbol> &out)
+{
+  const Elf64_Phdr *phdr = module.phdrs();
+  for (int i = 0; i < module.ehdr()->e_phnum; ++i)
+  {
+    if (phdr[i].p_type != PT_DYNAMIC)
+    {
+      continue;
+    }
+    uint64_t symtab = 0, strtab = 0, strsz = 0, hash = 0, gnu_hash = 0;
+    const Elf64_Dyn *dyn = module.at<Elf64_Dyn>(phdr[i].p_offset, phdr[i].p_filesz / sizeof(Elf64_Dyn));
+    for (uint64_t k = 0; dyn && k < phdr[i].p_filesz / sizeof(Elf64_Dyn) && dyn[k].d_tag != DT_NULL; ++k)
+    {
+      switch (dyn[k].d_tag)
+      {
+      case DT_SYMTAB:
+        symtab = dyn[k].d_un.d_ptr;
+        break;
+      case DT_STRTAB:
+        strtab = dyn[k].d_un.d_ptr;
+        break;
+      case DT_STRSZ:
+        strsz = dyn[k].d_un.d_val;
+        break;
+      case DT_HASH:
+        hash = dyn[k].d_un.d_ptr;
+        break;
+      case DT_GNU_HASH:
+        gnu_hash = dyn[k].d_un.d_ptr;
+        break;
+      }
+    }
+
+    uint64_t symtab_at, strtab_at, hash_at;
+    if (!module.vaddr_offset(symtab, symtab_at) || !module.vaddr_offset(strtab, strtab_at))
+    {
+      return;
+    }
+    uint64_t count = 0;
+    if (gnu_hash && module.vaddr_offset(gnu_hash, hash_at))
+    {
+      count = gnu_hash_symbol_count(module, hash_at);
+    }
+    else if (hash && module.vaddr_offset(hash, hash_at) && module.at<uint32_t>(hash_at, 2))
+    {
+      count = module.at<uint32_t>(hash_at, 2)[1];
+    }
+    collect_symbols(module, module.at<Elf64_Sym>(symtab_at, count), count, module.at<char>(strtab_at, strsz), strsz, out);
+    return;
+  }
+}
+
+// Flattens a module's symbols into the index layout described above.
+std::vector<unsigned char> build_symbol_index(const ElfModule &module)
+{
+  std::vector<ParsedSymbol> symbols;
+  const Elf64_Ehdr *ehdr = module.ehdr();
+  const Elf64_Shdr *sections = ehdr->e_shentsize == sizeof(Elf64_Shdr) ? module.at<Elf64_Shdr>(ehdr->e_shoff, ehdr->e_shnum) : nullptr;
+  for (int i = 0; sections && i < ehdr->e_shnum; ++i)
+  {
+    const Elf64_Shdr &section = sections[i];
+    if ((section.sh_type != SHT_SYMTAB && section.sh_type != SHT_DYNSYM) || section.sh_link >= ehdr->e_shnum)
+    {
+      continue;
+    }
+    const Elf64_Shdr &names = sections[section.sh_link];
+    uint64_t count = section.sh_size / sizeof(Elf64_Sym);
+    collect_symbols(module, module.at<Elf64_Sym>(section.sh_offset, count), count,
+                    module.at<char>(names.sh_offset, names.sh_size), names.sh_size, symbols);
+  }
+  if (symbols.empty())
+  {
+    collect_dynamic_symbols(module, symbols);
+  }
+
+  // .symtab repeats most of .dynsym.
+  std::sort(symbols.begin(), symbols.end(), [](const ParsedSymbol &a, const ParsedSymbol &b)
+            { return a.value != b.value ? a.value < b.value : strcmp(a.name, b.name) < 0; });
+  symbols.erase(std::unique(symbols.begin(), symbols.end(), [](const ParsedSymbol &a, const ParsedSymbol &b)
+                            { return a.value == b.value && strcmp(a.name, b.name) == 0; }),
+                symbols.end());
+
+  std::vector<uint32_t> by_name(symbols.size());
+  for (size_t i = 0; i < symbols.size(); ++i)
+  {
+    by_name[i] = i;
+  }
+  // Among equal names, global definitions come before local ones.
+  std::stable_sort(by_name.begin(), by_name.end(), [&](uint32_t a, uint32_t b)
+                   {
+                     int order = strcmp(symbols[a].name, symbols[b].name);
+                     if (order != 0)
+                     {
+                       return order < 0;
+                     }
+                     return ELF64_ST_BIND(symbols[a].info) != STB_LOCAL && ELF64_ST_BIND(symbols[b].info) == STB_LOCAL; });
+
+  std::string strings(1, '\0');
+  std::vector<SymbolEntry> entries(symbols.size());
+  for (size_t i = 0; i < symbols.size(); ++i)
+  {
+    entries[i] = {symbols[i].value, symbols[i].size, (uint32_t)strings.size(), symbols[i].info};
+    strings.append(symbols[i].name, strlen(symbols[i].name) + 1);
+  }
+
+  SymbolIndexHeader header;
+  memcpy(header.magic, symbol_index_magic, 8);
+  header.count = entries.size();
+  header.strings_size = strings.size();
+  header.reserved = 0;
+  std::vector<unsigned char> index(sizeof(header) + entries.size() * sizeof(SymbolEntry) + by_name.size() * 4 + strings.size());
+  unsigned char *p = index.data();
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  memcpy(p, entries.data(), entries.size() * sizeof(SymbolEntry));
+  p += entries.size() * sizeof(SymbolEntry);
+  memcpy(p, by_name.data(), by_name.size() * 4);
+  p += by_name.size() * 4;
+  memcpy(p, strings.data(), strings.size());
+  return index;
+}
+
+// $XDG_CACHE_HOME/readmemlib/symbols, or ~/.cache/readmemlib/symbols.
+std::string default_symbol_cache_dir()
+{
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg && *xdg)
+  {
+    return std::string(xdg) + "/readmemlib/symbols";
+  }
+  return home && *home ? std::string(home) + "/.cache/readmemlib/symbols" : "";
+}
+
+// Writes the index next to its final name and renames it into place, so
+// concurrent runs never see a partial file. Failing to cache is not an error.
+void store_symbol_index(const std::string &dir, const std::string &key, const std::vector<unsigned char> &index)
+{
+  for (size_t slash = dir.find('/', 1); slash != std::string::npos; slash = dir.find('/', slash + 1))
+  {
+    mkdir(dir.substr(0, slash).c_str(), 0755);
+  }
+  mkdir(dir.c_str(), 0755);
+
+  std::string path = dir + "/" + key + ".syms";
+  std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    return;
+  }
+  bool complete = write(fd, index.data(), index.size()) == (ssize_t)index.size();
+  close(fd);
+  if (!complete || rename(temporary.c_str(), path.c_str()) != 0)
+  {
+    unlink(temporary.c_str());
+  }
+}
+
+std::mutex symbol_tables_mutex;
+std::unordered_map<std::string, std::shared_ptr<const SymbolTable>> symbol_tables;
+
+// The symbols of the module mapped at region, and the bias to add to their
+// values. Looked up in memory, then in cache_dir by build-id, and only then
+// parsed. The file is opened through /proc/<pid>/map_files first, which
+// also works for deleted files and other mount namespaces.
+std::shared_ptr<const SymbolTable> module_symbols(pid_t pid, const MemoryRegion &region, const std::string &cache_dir,
+                                                  unsigned long long &bias, std::string &error)
+{
+  char map_file[96];
+  snprintf(map_file, sizeof(map_file), "/proc/%d/map_files/%llx-%llx", pid, region.start, region.end);
+  ElfModule module;
+  if (!open_elf_module(map_file, module, error) && !open_elf_module("/proc/" + std::to_string(pid) + "/root" + region.path, module, error) &&
+      !open_elf_module(region.path, module, error))
+  {
+    return nullptr;
+  }
+  bias = region.start - region.offset - module.first_load;
+
+  {
+    std::lock_guard<std::mutex> lock(symbol_tables_mutex);
+    auto it = symbol_tables.find(module.key);
+    if (it != symbol_tables.end())
+    {
+      return it->second;
+    }
+  }
+
+  auto table = std::make_shared<SymbolTable>();
+  bool cached = module.has_build_id && !cache_dir.empty() && table->load(cache_dir + "/" + module.key + ".syms");
+  if (!cached)
+  {
+    table = std::make_shared<SymbolTable>();
+    table->owned = build_symbol_index(module);
+    table->attach(table->owned.data(), table->owned.size());
+    if (module.has_build_id && !cache_dir.empty())
+    {
+      store_symbol_index(cache_dir, module.key, table->owned);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(symbol_tables_mutex);
+  symbol_tables[module.key] = table;
+  return table;
+}
+
+// The mapping of a module at file offset 0, by full path or file name.
+const MemoryRegion *find_module_region(const ProcessMaps &maps, const std::string &module)
+{
+  const MemoryRegion *found = nullptr;
+  for (const MemoryRegion &region : maps.regions)
+  {
+    if (!region.path.empty() && region.path[0] == '/' && (region.path == module || path_basename(region.path) == module) &&
+        (!found || region.offset < found->offset))
+    {
+      found = &region;
+    }
+  }
+  return found;
+}
+
+bool get_symbol_cache_dir(const Napi::Value &options, std::string &cache_dir)
+{
+  cache_dir = default_symbol_cache_dir();
+  if (!options.IsObject() || !options.As<Napi::Object>().Has("cacheDir"))
+  {
+    return true;
+  }
+  Napi::Value value = options.As<Napi::Object>().Get("cacheDir");
+  if (value.IsString())
+  {
+    cache_dir = value.As<Napi::String>().Utf8Value();
+    return true;
+  }
+  cache_dir.clear();
+  return value.IsBoolean() && !value.As<Napi::Boolean>().Value();
+}
+
+// resolve_symbol(pid, module, symbol, options) returns the address of a
+// function or object defined in a mapped module as a BigInt, or null.
+// options.cacheDir overrides where symbol indexes are kept, false disables
+// the on-disk cache.
+Napi::Value resolve_symbol(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string cache_dir;
+  if (!info[1].IsString() || !info[2].IsString() || !get_symbol_cache_dir(info[3], cache_dir))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
+  {
+    return env.Null();
+  }
+  const MemoryRegion *region = find_module_region(*maps, info[1].As<Napi::String>().Utf8Value());
+  if (!region)
+  {
+    return env.Null();
+  }
+
+  unsigned long long bias;
+  std::string error;
+  std::shared_ptr<const SymbolTable> table = module_symbols(proc->pid, *region, cache_dir, bias, error);
+  if (!table)
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  const SymbolEntry *symbol = table->find(info[2].As<Napi::String>().Utf8Value());
+  if (!symbol)
+  {
+    return env.Null();
+  }
+  return Napi::BigInt::New(env, (uint64_t)(symbol->value + bias));
+}
+
+// symbolize(pid, address, options) returns { module, base, symbol, address,
+// offset } for an address inside a mapped module: the symbol covering it and
+// its start, or symbol null and the offset from the module base when none
+// does. Returns null for addresses outside file mappings.
+Napi::Value symbolize(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long addr;
+  std::string cache_dir;
+  if (!get_address(info[1], addr) || !get_symbol_cache_dir(info[2], cache_dir))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
+  {
+    return env.Null();
+  }
+  const MemoryRegion *mapping = maps->find(addr);
+  if (!mapping || mapping->path.empty() || mapping->path[0] != '/')
+  {
+    return env.Null();
+  }
+  const MemoryRegion *region = find_module_region(*maps, mapping->path);
+
+  unsigned long long bias;
+  std::string error;
+  std::shared_ptr<const SymbolTable> table = module_symbols(proc->pid, *region, cache_dir, bias, error);
+  if (!table)
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("module", Napi::String::New(env, mapping->path));
+  result.Set("base", Napi::BigInt::New(env, (uint64_t)region->start));
+  const SymbolEntry *symbol = table->containing(addr - bias);
+  if (symbol)
+  {
+    result.Set("symbol", Napi::String::New(env, table->name(*symbol)));
+    result.Set("address", Napi::BigInt::New(env, (uint64_t)(symbol->value + bias)));
+    result.Set("offset", Napi::Number::New(env, addr - (symbol->value + bias)));
+  }
+  else
+  {
+    result.Set("symbol", env.Null());
+    result.Set("address", Napi::BigInt::New(env, (uint64_t)region->start));
+    result.Set("offset", Napi::Number::New(env, addr - region->start));
+  }
+  return result;
+}
+
+Napi::Value get_pid_from_window_title(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string window_title = info[0].As<Napi::String>();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+  pid_t pid = -1;
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    char *name;
+    if (XFetchName(display, window, &name) > 0)
+    {
+      std::string current_title(name);
+      XFree(name);
+
+      if (current_title == window_title)
+      {
+        Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+        Atom pid_type;
+        int pid_format;
+        unsigned long pid_nitems, pid_bytes_remaining;
+        unsigned char *pid_data = NULL;
+
+        if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                               &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+        {
+          if (pid_data != NULL)
+          {
+            pid = *((pid_t *)pid_data);
+            XFree(pid_data);
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  if (pid != -1)
+  {
+    return Napi::Number::New(env, pid);
+  }
+  else
+  {
+    Napi::Error::New(env, "Window with the specified title not found").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value get_pids_from_partial_title(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string partial_title = info[0].As<Napi::String>();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+  Napi::Array result = Napi::Array::New(env);
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    char *name;
+    if (XFetchName(display, window, &name) > 0)
+    {
+      std::string current_title(name);
+      XFree(name);
+
+      if (current_title.find(partial_title) != std::string::npos)
+      {
+        Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+        Atom classname_property = XInternAtom(display, "WM_CLASS", true);
+        Atom pid_type, classname_type;
+        int pid_format, classname_format;
+        unsigned long pid_nitems, classname_nitems, pid_bytes_remaining, classname_bytes_remaining;
+        unsigned char *pid_data = NULL, *classname_data = NULL;
+
+        if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                               &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success &&
+            XGetWindowProperty(display, window, classname_property, 0, (~0L), false, XA_STRING,
+                               &classname_type, &classname_format, &classname_nitems, &classname_bytes_remaining, &classname_data) == Success)
+        {
+          if (pid_data != NULL && classname_data != NULL)
+          {
+            pid_t pid = *((pid_t *)pid_data);
+            std::string classname(reinterpret_cast<char *>(classname_data));
+
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("pid", Napi::Number::New(env, pid));
+            entry.Set("title", Napi::String::New(env, current_title));
+            entry.Set("classname", Napi::String::New(env, classname));
+
+            result.Set(result.Length(), entry);
+            XFree(pid_data);
+            XFree(classname_data);
+          }
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  return result;
+}
+
+Napi::Value get_window_title_by_pid(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+  std::string window_title = "";
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+    Atom pid_type;
+    int pid_format;
+    unsigned long pid_nitems, pid_bytes_remaining;
+    unsigned char *pid_data = NULL;
+
+    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+    {
+      if (pid_data != NULL)
+      {
+        pid_t pid = *((pid_t *)pid_data);
+        XFree(pid_data);
+
+        if (pid == target_pid)
+        {
+          char *name;
+          if (XFetchName(display, window, &name) > 0)
+          {
+            window_title = std::string(name);
+            XFree(name);
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  if (!window_title.empty())
+  {
+    return Napi::String::New(env, window_title);
+  }
+  else
+  {
+    Napi::Error::New(env, "Window with the specified PID not found").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+Napi::Value disable_window_input(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+    Atom pid_type;
+    int pid_format;
+    unsigned long pid_nitems, pid_bytes_remaining;
+    unsigned char *pid_data = NULL;
+
+    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+    {
+      if (pid_data != NULL)
+      {
+        pid_t pid = *((pid_t *)pid_data);
+        XFree(pid_data);
+
+        if (pid == target_pid)
+        {
+          // Disable input for the window
+          XSelectInput(display, window, 0);
+
+          // Make the window passthrough
+          XserverRegion region = XFixesCreateRegion(display, NULL, 0);
+          XFixesSetWindowShapeRegion(display, window, ShapeInput, 0, 0, region);
+          XFixesDestroyRegion(display, region);
+
+          break;
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  return env.Null();
+}
+
+Napi::Value enable_window_input(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+    Atom pid_type;
+    int pid_format;
+    unsigned long pid_nitems, pid_bytes_remaining;
+    unsigned char *pid_data = NULL;
+
+    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+    {
+      if (pid_data != NULL)
+      {
+        pid_t pid = *((pid_t *)pid_data);
+        XFree(pid_data);
+
+        if (pid == target_pid)
+        {
+          // Enable input for the window
+          XSelectInput(display, window, StructureNotifyMask | SubstructureNotifyMask);
+
+          // Reset the input shape
+          XShapeCombineMask(display, window, ShapeInput, 0, 0, None, ShapeSet);
+
+          break;
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  return env.Null();
+}
+
+Napi::Value make_window_topmost(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Window root = DefaultRootWindow(display);
+  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
+  Atom actual_type;
+  int actual_format;
+  unsigned long num_windows, bytes_remaining;
+  unsigned char *data = NULL;
+
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+    Atom pid_type;
+    int pid_format;
+    unsigned long pid_nitems, pid_bytes_remaining;
+    unsigned char *pid_data = NULL;
+
+    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+    {
+      if (pid_data != NULL)
+      {
+        pid_t pid = *((pid_t *)pid_data);
+        XFree(pid_data);
+
+        if (pid == target_pid)
+        {
+          // Make the window topmost
+          XRaiseWindow(display, window);
+          break;
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  return env.Null();
+}
+
+static void destroy_window_cb(GtkWidget *widget, GtkWidget *window)
+{
+  gtk_main_quit();
+}
+
+Napi::Value create_browser_window(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string url = info[0].As<Napi::String>().Utf8Value();
+
+  std::thread([url]
+              {
+ gtk_init(0, NULL);
+
+    // Create a GTK window
+    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_default_size(GTK_WINDOW(window), 800, 600);
+    g_signal_connect(window, "destroy", G_CALLBACK(destroy_window_cb), NULL);
+    gtk_window_set_title(GTK_WINDOW(window),"overlay-next-ag");
+    // Set window to fullscreen
+    // gtk_window_fullscreen(GTK_WINDOW(window));
+
+             // Set window to borderless
+    gtk_window_set_decorated(GTK_WINDOW(window), FALSE);
+
+                // Set window position to (0, 0)
+    gtk_window_set_default_size(GTK_WINDOW(window), 1, 1);
+    gtk_window_move(GTK_WINDOW(window), 0, 0);
+    // Set window to transparent
+    GdkScreen *screen = gtk_window_get_screen(GTK_WINDOW(window));
+    GdkVisual *visual = gdk_screen_get_rgba_visual(screen);
+
+    if (visual != NULL && gdk_screen_is_composited(screen))
+    {
+        gtk_widget_set_visual(window, visual);
+        gtk_widget_set_app_paintable(window, TRUE);
+    }
+
+    // Create a WebKit web view and add it to the window
+    WebKitWebView *web_view = WEBKIT_WEB_VIEW(webkit_web_view_new());
+    gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(web_view));
+
+    // Set WebKitWebView background to transparent
+    GdkRGBA rgba = { .alpha = 0.0 };
+    webkit_web_view_set_background_color(web_view, &rgba);
+    gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(web_view));
+
+    gtk_window_set_keep_above(GTK_WINDOW(window), TRUE);
+    // Load the specified URL
+    webkit_web_view_load_uri(web_view, url.c_str());
+
+    // Show the window and run the GTK main loop
+    gtk_widget_show_all(window);
+    gtk_main(); })
+      .detach();
+
+  return env.Null();
+}
+
+Napi::Value set_window_size_by_pid(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+  int new_height = info[1].As<Napi::Number>().Int32Value();
+  int new_width = info[2].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
   Window root = DefaultRootWindow(display);
   Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
@@ -305,522 +3961,5836 @@ Napi::Value get_window_title_by_pid(const Napi::CallbackInfo &info)
   unsigned long num_windows, bytes_remaining;
   unsigned char *data = NULL;
 
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
+                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  {
+    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
+    XCloseDisplay(display);
+    return env.Null();
+  }
+
+  Window *window_list = (Window *)data;
+
+  for (unsigned long i = 0; i < num_windows; ++i)
+  {
+    Window window = window_list[i];
+    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
+    Atom pid_type;
+    int pid_format;
+    unsigned long pid_nitems, pid_bytes_remaining;
+    unsigned char *pid_data = NULL;
+
+    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
+                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+    {
+      if (pid_data != NULL)
+      {
+        pid_t pid = *((pid_t *)pid_data);
+        XFree(pid_data);
+
+        if (pid == target_pid)
+        {
+          // Get the current geometry of the window
+          XWindowAttributes attrs;
+          XGetWindowAttributes(display, window, &attrs);
+
+          // Set the window height to the new value
+          XMoveResizeWindow(display, window, attrs.x, attrs.y, new_width, new_height);
+          break;
+        }
+      }
+    }
+  }
+
+  XFree(window_list);
+  XCloseDisplay(display);
+
+  return env.Null();
+}
+
+Napi::Value get_async_key_state(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsNumber())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  int key_code = info[0].As<Napi::Number>().Int32Value();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  char keys_return[32];
+  XQueryKeymap(display, keys_return);
+  KeyCode kc = XKeysymToKeycode(display, key_code);
+  bool is_pressed = (keys_return[kc / 8] & (1 << (kc % 8))) != 0;
+
+  XCloseDisplay(display);
+
+  return Napi::Boolean::New(env, is_pressed);
+}
+
+Napi::Object get_screen_size(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  Display *display = XOpenDisplay(NULL);
+  if (display == NULL)
+  {
+    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    return Napi::Object::New(env);
+  }
+
+  int screen_num = DefaultScreen(display);
+  int screen_width = DisplayWidth(display, screen_num);
+  int screen_height = DisplayHeight(display, screen_num);
+
+  XCloseDisplay(display);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("width", Napi::Number::New(env, screen_width));
+  result.Set("height", Napi::Number::New(env, screen_height));
+
+  return result;
+}
+
+// bytes holds the pattern and mask 0xff for every byte that has to match
+// (0 for ?? wildcards), both padded with zeros to a multiple of 32 so the
+// vector kernels can compare whole registers. anchor and anchor2 index the
+// two rarest fixed bytes, -1 if there are none. skip is the
+// Boyer-Moore-Horspool shift for each value of a window's last byte; a
+// wildcard limits every shift to its distance from the end.
+struct Signature
+{
+  std::string source;
+  std::vector<unsigned char> bytes;
+  std::vector<unsigned char> mask;
+  std::vector<unsigned> skip;
+  size_t size;
+  int anchor;
+  int anchor2;
+};
+
+// Rough byte frequencies in x86-64 code and data, higher is more common.
+// Bytes not listed are treated as rare.
+int byte_frequency(unsigned char byte)
+{
+  switch (byte)
+  {
+  case 0x00:
+    return 100;
+  case 0xff:
+    return 60;
+  case 0x48:
+  case 0x8b:
+    return 40;
+  case 0x89:
+  case 0x0f:
+  case 0x24:
+  case 0x01:
+  case 0x4c:
+  case 0x44:
+  case 0x85:
+  case 0xe8:
+  case 0x8d:
+  case 0x83:
+  case 0xc0:
+  case 0x20:
+    return 20;
+  case 0x41:
+  case 0x49:
+  case 0x45:
+  case 0x74:
+  case 0x75:
+  case 0x10:
+  case 0x08:
+  case 0x04:
+  case 0x02:
+  case 0x03:
+  case 0xcc:
+  case 0x90:
+  case 0xc3:
+    return 10;
+  default:
+    return 1;
+  }
+}
+
+void prepare_signature(Signature &sig)
+{
+  sig.size = sig.bytes.size();
+  sig.anchor = sig.anchor2 = -1;
+  for (size_t i = 0; i < sig.size; ++i)
+  {
+    if (!sig.mask[i])
+    {
+      continue;
+    }
+    int f = byte_frequency(sig.bytes[i]);
+    if (sig.anchor < 0 || f < byte_frequency(sig.bytes[sig.anchor]))
+    {
+      sig.anchor2 = sig.anchor;
+      sig.anchor = i;
+    }
+    else if (sig.anchor2 < 0 || f < byte_frequency(sig.bytes[sig.anchor2]))
+    {
+      sig.anchor2 = i;
+    }
+  }
+  if (sig.anchor2 < 0)
+  {
+    sig.anchor2 = sig.anchor;
+  }
+
+  size_t longest = sig.size;
+  for (size_t i = 0; i + 1 < sig.size; ++i)
+  {
+    if (!sig.mask[i])
+    {
+      longest = sig.size - 1 - i;
+    }
+  }
+  sig.skip.assign(256, std::max<size_t>(longest, 1));
+  for (size_t i = 0; i + 1 < sig.size; ++i)
+  {
+    if (sig.mask[i])
+    {
+      sig.skip[sig.bytes[i]] = std::min<size_t>(sig.skip[sig.bytes[i]], sig.size - 1 - i);
+    }
+  }
+
+  size_t padded = (sig.size + 31) & ~(size_t)31;
+  sig.bytes.resize(padded, 0);
+  sig.mask.resize(padded, 0);
+}
+
+int hex_digit(char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parses whitespace separated hex bytes, with ? or ?? for wildcards. On
+// failure returns false and describes the offending token in error.
+bool parse_signature(const std::string &sig_str, Signature &sig, std::string &error)
+{
+  sig.source = sig_str;
+  sig.bytes.clear();
+  sig.mask.clear();
+  size_t i = 0;
+  while (i < sig_str.size())
+  {
+    if (isspace((unsigned char)sig_str[i]))
+    {
+      ++i;
+      continue;
+    }
+    size_t end = i;
+    while (end < sig_str.size() && !isspace((unsigned char)sig_str[end]))
+    {
+      ++end;
+    }
+    std::string token = sig_str.substr(i, end - i);
+    if (token == "?" || token == "??")
+    {
+      sig.bytes.push_back(0);
+      sig.mask.push_back(0);
+    }
+    else if (token.size() == 2 && hex_digit(token[0]) >= 0 && hex_digit(token[1]) >= 0)
+    {
+      sig.bytes.push_back(hex_digit(token[0]) << 4 | hex_digit(token[1]));
+      sig.mask.push_back(0xff);
+    }
+    else
+    {
+      error = "Invalid signature byte '" + token + "' at offset " + std::to_string(i);
+      return false;
+    }
+    i = end;
+  }
+  if (sig.bytes.empty())
+  {
+    error = "Empty signature";
+    return false;
+  }
+  prepare_signature(sig);
+  return true;
+}
+
+bool compare_bytes(const unsigned char *data, const Signature &sig)
+{
+  for (size_t i = 0; i < sig.size; ++i)
+  {
+    if ((data[i] ^ sig.bytes[i]) & sig.mask[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A parsed signature for reuse across scans, from compile_signature. Every
+// scan export accepts one wherever it takes a signature string.
+class SignatureHandle : public Napi::ObjectWrap<SignatureHandle>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "Signature",
+                       {InstanceAccessor("pattern", &SignatureHandle::get_pattern, nullptr),
+                        InstanceAccessor("size", &SignatureHandle::get_size, nullptr)});
+  }
+
+  SignatureHandle(const Napi::CallbackInfo &info) : Napi::ObjectWrap<SignatureHandle>(info)
+  {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return;
+    }
+
+    std::shared_ptr<Signature> parsed = std::make_shared<Signature>();
+    std::string error;
+    if (!parse_signature(info[0].As<Napi::String>().Utf8Value(), *parsed, error))
+    {
+      Napi::Error::New(env, error).ThrowAsJavaScriptException();
+      return;
+    }
+    sig = parsed;
+  }
+
+  std::shared_ptr<const Signature> sig;
+
+private:
+  Napi::Value get_pattern(const Napi::CallbackInfo &info)
+  {
+    return Napi::String::New(info.Env(), sig ? sig->source : "");
+  }
+
+  Napi::Value get_size(const Napi::CallbackInfo &info)
+  {
+    return Napi::Number::New(info.Env(), sig ? sig->size : 0);
+  }
+};
+
+bool is_signature_handle(const Napi::Value &value)
+{
+  if (!value.IsObject())
+  {
+    return false;
+  }
+  AddonData *data = value.Env().GetInstanceData<AddonData>();
+  return value.As<Napi::Object>().InstanceOf(data->signature_handle.Value());
+}
+
+bool is_signature(const Napi::Value &value)
+{
+  return value.IsString() || is_signature_handle(value);
+}
+
+// Accepts a signature string or a handle from compile_signature. Throws into
+// JS and returns null if the value is neither or does not parse.
+std::shared_ptr<const Signature> get_signature(Napi::Env env, const Napi::Value &value)
+{
+  if (is_signature_handle(value))
+  {
+    return SignatureHandle::Unwrap(value.As<Napi::Object>())->sig;
+  }
+  if (!value.IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+
+  std::shared_ptr<Signature> sig = std::make_shared<Signature>();
+  std::string error;
+  if (!parse_signature(value.As<Napi::String>().Utf8Value(), *sig, error))
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return sig;
+}
+
+enum ScanKernel
+{
+  KERNEL_AUTO,
+  KERNEL_LEGACY,
+  KERNEL_SCALAR,
+  KERNEL_BMH,
+  KERNEL_MEMCHR,
+  KERNEL_SSE2,
+  KERNEL_AVX2
+};
+
+bool parse_scan_kernel(const std::string &name, ScanKernel &kernel)
+{
+  static const char *names[] = {"auto", "legacy", "scalar", "bmh", "memchr", "sse2", "avx2"};
+  for (int i = 0; i <= KERNEL_AVX2; ++i)
+  {
+    if (name == names[i])
+    {
+      kernel = static_cast<ScanKernel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// The fastest kernel this CPU supports, decided once at runtime.
+ScanKernel best_scan_kernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  static const ScanKernel kernel = __builtin_cpu_supports("avx2") ? KERNEL_AVX2 : __builtin_cpu_supports("sse2") ? KERNEL_SSE2
+                                                                                                               : KERNEL_MEMCHR;
+  return kernel;
+#else
+  return KERNEL_MEMCHR;
+#endif
+}
+
+// The kernels below return the first offset i < last with a match at
+// data + i, or -1. The caller guarantees last + sig.size - 1 <= len.
+
+long long find_scalar(const unsigned char *data, size_t len, size_t last, const Signature &sig)
+{
+  for (size_t i = 0; i < last; ++i)
+  {
+    if (compare_bytes(data + i, sig))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// The matcher sigscan used before the kernels above, kept as the benchmark
+// baseline: a byte vector and a vector<bool> wildcard mask, compared at every
+// offset.
+long long find_legacy(const unsigned char *data, size_t last, const Signature &sig)
+{
+  std::vector<unsigned char> signature(sig.bytes.begin(), sig.bytes.begin() + sig.size);
+  std::vector<bool> mask(sig.size);
+  for (size_t i = 0; i < sig.size; ++i)
+  {
+    mask[i] = sig.mask[i] == 0;
+  }
+
+  for (size_t i = 0; i < last; ++i)
+  {
+    bool match = true;
+    for (size_t j = 0; j < signature.size(); ++j)
+    {
+      if (!mask[j] && data[i + j] != signature[j])
+      {
+        match = false;
+        break;
+      }
+    }
+    if (match)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Boyer-Moore-Horspool: after a mismatch, shift by the skip entry for the
+// last byte of the window.
+long long find_bmh(const unsigned char *data, size_t len, size_t last, const Signature &sig)
+{
+  for (size_t i = 0; i < last; i += sig.skip[data[i + sig.size - 1]])
+  {
+    if (compare_bytes(data + i, sig))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// memchr for the rarest byte, then a full compare at each hit.
+long long find_memchr(const unsigned char *data, size_t len, size_t last, const Signature &sig)
+{
+  const unsigned char *begin = data + sig.anchor;
+  const unsigned char *end = begin + last;
+  for (const unsigned char *hit = begin; (hit = (const unsigned char *)memchr(hit, sig.bytes[sig.anchor], end - hit)); ++hit)
+  {
+    size_t i = hit - begin;
+    if (compare_bytes(data + i, sig))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2"))) bool verify_sse2(const unsigned char *data, size_t avail, const Signature &sig)
+{
+  size_t padded = (sig.size + 15) & ~(size_t)15;
+  if (avail < padded)
+  {
+    return compare_bytes(data, sig);
+  }
+  for (size_t k = 0; k < padded; k += 16)
+  {
+    __m128i diff = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + k)), _mm_loadu_si128((const __m128i *)(sig.bytes.data() + k)));
+    diff = _mm_and_si128(diff, _mm_loadu_si128((const __m128i *)(sig.mask.data() + k)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compares 16 candidate positions at once against the two rarest bytes and
+// verifies the survivors with masked 16-byte compares.
+__attribute__((target("sse2"))) long long find_sse2(const unsigned char *data, size_t len, size_t last, const Signature &sig)
+{
+  const __m128i first = _mm_set1_epi8(sig.bytes[sig.anchor]);
+  const __m128i second = _mm_set1_epi8(sig.bytes[sig.anchor2]);
+  size_t i = 0;
+  for (; i + 16 <= last; i += 16)
+  {
+    __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + sig.anchor)), first);
+    __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + sig.anchor2)), second);
+    unsigned bits = _mm_movemask_epi8(_mm_and_si128(a, b));
+    while (bits)
+    {
+      size_t k = i + __builtin_ctz(bits);
+      if (verify_sse2(data + k, len - k, sig))
+      {
+        return k;
+      }
+      bits &= bits - 1;
+    }
+  }
+  long long hit = find_scalar(data + i, len - i, last - i, sig);
+  return hit < 0 ? -1 : i + hit;
+}
+
+__attribute__((target("avx2"))) bool verify_avx2(const unsigned char *data, size_t avail, const Signature &sig)
+{
+  size_t padded = sig.bytes.size();
+  if (avail < padded)
+  {
+    return compare_bytes(data, sig);
+  }
+  for (size_t k = 0; k < padded; k += 32)
+  {
+    __m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + k)), _mm256_loadu_si256((const __m256i *)(sig.bytes.data() + k)));
+    if (!_mm256_testz_si256(diff, _mm256_loadu_si256((const __m256i *)(sig.mask.data() + k))))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+__attribute__((target("avx2"))) long long find_avx2(const unsigned char *data, size_t len, size_t last, const Signature &sig)
+{
+  const __m256i first = _mm256_set1_epi8(sig.bytes[sig.anchor]);
+  const __m256i second = _mm256_set1_epi8(sig.bytes[sig.anchor2]);
+  size_t i = 0;
+  for (; i + 32 <= last; i += 32)
+  {
+    __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + sig.anchor)), first);
+    __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + sig.anchor2)), second);
+    unsigned bits = _mm256_movemask_epi8(_mm256_and_si256(a, b));
+    while (bits)
+    {
+      size_t k = i + __builtin_ctz(bits);
+      if (verify_avx2(data + k, len - k, sig))
+      {
+        return k;
+      }
+      bits &= bits - 1;
+    }
+  }
+  long long hit = find_scalar(data + i, len - i, last - i, sig);
+  return hit < 0 ? -1 : i + hit;
+}
+#endif
+
+// First offset in data[0, len) where the signature matches and starts
+// before limit, or -1.
+long long find_signature(const unsigned char *data, size_t len, size_t limit, const Signature &sig, ScanKernel kernel = KERNEL_AUTO)
+{
+  if (len < sig.size)
+  {
+    return -1;
+  }
+  size_t last = std::min(limit, len - sig.size + 1);
+  if (last == 0)
+  {
+    return -1;
+  }
+  if (sig.anchor < 0)
+  {
+    return 0;
+  }
+
+  if (kernel == KERNEL_AUTO)
+  {
+    kernel = best_scan_kernel();
+    // Without vector kernels, a signature whose rarest byte is still common
+    // stops memchr too often; BMH does better once it can skip a few bytes.
+    if (kernel == KERNEL_MEMCHR && byte_frequency(sig.bytes[sig.anchor]) >= 20 &&
+        *std::min_element(sig.skip.begin(), sig.skip.end()) >= 4)
+    {
+      kernel = KERNEL_BMH;
+    }
+  }
+
+  switch (kernel)
+  {
+  case KERNEL_LEGACY:
+    return find_legacy(data, last, sig);
+  case KERNEL_SCALAR:
+    return find_scalar(data, len, last, sig);
+  case KERNEL_BMH:
+    return find_bmh(data, len, last, sig);
+#if defined(__x86_64__) || defined(__i386__)
+  case KERNEL_SSE2:
+    return find_sse2(data, len, last, sig);
+  case KERNEL_AVX2:
+    return find_avx2(data, len, last, sig);
+#endif
+  default:
+    return find_memchr(data, len, last, sig);
+  }
+}
+
+// Scans forward from start_addr in 4 KiB chunks until a read fails. The
+// chunk that runs into unreadable memory is still scanned up to where the
+// read stopped. Stops early, without a match, once cancelled is set.
+bool scan_signature(ProcessMemory &proc, unsigned long long start_addr, const Signature &sig,
+                    unsigned long long &found_addr, const std::atomic<bool> *cancelled)
+{
+  std::vector<unsigned char> buffer(std::max<size_t>(4096, sig.size * 2));
+  unsigned long long address = 0;
+
+  while (!(cancelled && *cancelled))
+  {
+    ssize_t n = read_span(proc, start_addr + address, buffer.data(), buffer.size());
+    if (n <= 0)
+    {
+      return false;
+    }
+
+    long long hit = find_signature(buffer.data(), n, n, sig);
+    if (hit >= 0)
+    {
+      found_addr = start_addr + address + hit;
+      return true;
+    }
+    if ((size_t)n < buffer.size())
+    {
+      return false;
+    }
+
+    address += buffer.size() - sig.size + 1;
+  }
+  return false;
+}
+
+// A slice of a scan. Matches must start inside [start, start + len); the
+// overlap extends the read into the next block so they may end past it.
+struct ScanBlock
+{
+  unsigned long long start;
+  size_t len;
+  size_t overlap;
+};
+
+struct ScanOptions
+{
+  RegionFilter filter;
+  size_t threads;
+  size_t block_size;
+  ScanKernel kernel;
+  size_t max_results;
+  unsigned long long alignment;
+  bool skip_non_resident;
+  bool skip_zero_pages;
+
+  ScanOptions()
+      : threads(0), block_size(4 << 20), kernel(KERNEL_AUTO), max_results(~(size_t)0), alignment(1),
+        skip_non_resident(false), skip_zero_pages(false)
+  {
+    filter.perms = "r";
+  }
+};
+
+bool get_scan_options(const Napi::Value &value, ScanOptions &options)
+{
+  if (!get_region_filter(value, options.filter))
+  {
+    return false;
+  }
+  if (value.IsObject())
+  {
+    Napi::Object object = value.As<Napi::Object>();
+    if (object.Has("threads"))
+    {
+      options.threads = object.Get("threads").ToNumber().Uint32Value();
+    }
+    if (object.Has("blockSize"))
+    {
+      options.block_size = std::max(4096u, object.Get("blockSize").ToNumber().Uint32Value());
+    }
+    // For sigscan_all: stop after maxResults matches, and only report
+    // addresses that are a multiple of alignment.
+    if (object.Has("maxResults"))
+    {
+      options.max_results = std::max<int64_t>(0, object.Get("maxResults").ToNumber().Int64Value());
+    }
+    if (object.Has("alignment"))
+    {
+      options.alignment = std::max<int64_t>(1, object.Get("alignment").ToNumber().Int64Value());
+    }
+    // Consult /proc/<pid>/pagemap and leave out anonymous pages that were
+    // never touched, and pages mapping the shared zero page.
+    if (object.Has("skipNonResident"))
+    {
+      options.skip_non_resident = object.Get("skipNonResident").ToBoolean();
+    }
+    if (object.Has("skipZeroPages"))
+    {
+      options.skip_zero_pages = object.Get("skipZeroPages").ToBoolean();
+    }
+    // Forces a matching kernel, for benchmarks. Kernels the CPU lacks fall back to the best one.
+    if (object.Has("kernel"))
+    {
+      if (!object.Get("kernel").IsString() || !parse_scan_kernel(object.Get("kernel").As<Napi::String>(), options.kernel))
+      {
+        return false;
+      }
+      if (options.kernel > best_scan_kernel() && options.kernel != KERNEL_MEMCHR)
+      {
+        options.kernel = KERNEL_AUTO;
+      }
+    }
+  }
+  return true;
+}
+
+// The address ranges of the regions selected by the filter, with adjacent
+// regions merged. Mappings that cannot be read through process memory
+// ([vvar], [vsyscall]) and device mappings are left out.
+std::vector<std::pair<unsigned long long, unsigned long long>> filter_spans(const ProcessMaps &maps, const RegionFilter &filter)
+{
+  std::vector<std::pair<unsigned long long, unsigned long long>> spans;
+  for (const MemoryRegion &region : maps.regions)
+  {
+    if (!filter.matches(region) || region.path.compare(0, 5, "[vvar") == 0 ||
+        region.path == "[vsyscall]" || region.path.compare(0, 5, "/dev/") == 0)
+    {
+      continue;
+    }
+    unsigned long long start = std::max(region.start, filter.start);
+    unsigned long long end = std::min(region.end, filter.end);
+    if (!spans.empty() && spans.back().second == start)
+    {
+      spans.back().second = end;
+    }
+    else
+    {
+      spans.push_back(std::make_pair(start, end));
+    }
+  }
+  return spans;
+}
+
+// Splits the selected spans into blocks, so a match may straddle two
+// adjacent regions.
+std::vector<ScanBlock> plan_scan(const ProcessMaps &maps, const ScanOptions &options, size_t pattern_size)
+{
+  std::vector<std::pair<unsigned long long, unsigned long long>> spans = filter_spans(maps, options.filter);
+
+  std::vector<ScanBlock> blocks;
+  for (const auto &span : spans)
+  {
+    for (unsigned long long start = span.first; start < span.second; start += options.block_size)
+    {
+      ScanBlock block;
+      block.start = start;
+      block.len = std::min<unsigned long long>(options.block_size, span.second - start);
+      block.overlap = std::min<unsigned long long>(pattern_size > 0 ? pattern_size - 1 : 0, span.second - start - block.len);
+      blocks.push_back(block);
+    }
+  }
+  return blocks;
+}
+
+// Pages a scan leaves out after consulting /proc/<pid>/pagemap. An
+// anonymous page that is neither present nor swapped was never touched and
+// reads as zeros; file-backed pages look the same when they are merely not
+// cached, so those are always read. The shared zero page is recognised by
+// its frame number, which pagemap only reveals to CAP_SYS_ADMIN; without it
+// zero pages are read like any other.
+class PageSkip
+{
+public:
+  PageSkip(const ProcessMemory &proc, const ProcessMaps &maps, const ScanOptions &options) : maps(maps)
+  {
+    if (!options.skip_non_resident && !options.skip_zero_pages)
+    {
+      return;
+    }
+    non_resident = options.skip_non_resident;
+    zero_pfn = options.skip_zero_pages ? zero_page_frame() : 0;
+    std::string path = "/proc/" + std::to_string(proc.pid) + "/pagemap";
+    pagemap = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+
+  ~PageSkip()
+  {
+    if (pagemap >= 0)
+    {
+      close(pagemap);
+    }
+  }
+
+  bool active() const
+  {
+    return pagemap >= 0;
+  }
+
+  // Sets keep[i] for each of the pages from base that has to be read. Only
+  // the part of a left-out page inside [count_from, count_to) adds to
+  // skipped, so pages shared with a neighbouring block's overlap are counted
+  // once, by the block that owns them.
+  void select(unsigned long long base, size_t pages, std::vector<unsigned char> &keep, unsigned long long count_from,
+              unsigned long long count_to)
+  {
+    const unsigned long long page = 4096;
+    keep.assign(pages, 1);
+    std::vector<uint64_t> entries(pages);
+    ssize_t n = pread(pagemap, entries.data(), pages * sizeof(uint64_t), base / page * sizeof(uint64_t));
+    size_t known = n > 0 ? n / sizeof(uint64_t) : 0;
+    const MemoryRegion *region = nullptr;
+    for (size_t i = 0; i < known; ++i)
+    {
+      unsigned long long addr = base + i * page;
+      if (!region || addr < region->start || addr >= region->end)
+      {
+        region = maps.find(addr);
+      }
+      bool present = entries[i] >> 63 & 1;
+      bool swapped = entries[i] >> 62 & 1;
+      bool anonymous = region && (region->path.empty() || region->path[0] == '[');
+      if ((non_resident && anonymous && !present && !swapped) ||
+          (zero_pfn != 0 && present && (entries[i] & ((1ULL << 55) - 1)) == zero_pfn))
+      {
+        keep[i] = 0;
+        unsigned long long from = std::max(addr, count_from);
+        unsigned long long to = std::min(addr + page, count_to);
+        if (from < to)
+        {
+          skipped += to - from;
+        }
+      }
+    }
+  }
+
+  std::atomic<unsigned long long> skipped{0};
+
+private:
+  // Frame number of the shared zero page: a never written page of our own,
+  // once read, maps it. 0 when pagemap hides frame numbers.
+  static uint64_t zero_page_frame()
+  {
+    static const uint64_t frame = []() -> uint64_t
+    {
+      const size_t page = 4096;
+      void *probe = mmap(nullptr, page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (probe == MAP_FAILED)
+      {
+        return 0;
+      }
+      (void)*(volatile unsigned char *)probe;
+      uint64_t entry = 0;
+      int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+      if (fd >= 0)
+      {
+        if (pread(fd, &entry, sizeof(entry), (unsigned long long)probe / page * sizeof(entry)) != sizeof(entry))
+        {
+          entry = 0;
+        }
+        close(fd);
+      }
+      munmap(probe, page);
+      return (entry >> 63 & 1) ? entry & ((1ULL << 55) - 1) : 0;
+    }();
+    return frame;
+  }
+
+  const ProcessMaps &maps;
+  int pagemap = -1;
+  bool non_resident = false;
+  uint64_t zero_pfn = 0;
+};
+
+// Reads [from, to) of a block into buf at the same offsets, and calls
+// visit(address, data, length) for every stretch that could be read. A page
+// that fails to read splits the stretch. Returns the number of bytes read.
+template <typename Visitor>
+size_t read_stretch(ProcessMemory &proc, const ScanBlock &block, std::vector<unsigned char> &buf, size_t from, size_t to, Visitor &visit)
+{
+  const unsigned long long page = 4096;
+  size_t segment = from;
+  size_t offset = from;
+  size_t bytes = 0;
+  while (offset < to)
+  {
+    ssize_t n = read_span(proc, block.start + offset, buf.data() + offset, to - offset);
+    if (n > 0)
+    {
+      offset += n;
+      bytes += n;
+      continue;
+    }
+    if (proc.exited)
+    {
+      break;
+    }
+
+    if (offset > segment)
+    {
+      visit(block.start + segment, buf.data() + segment, offset - segment);
+    }
+    unsigned long long next_page = ((block.start + offset) | (page - 1)) + 1;
+    offset = std::min<unsigned long long>(next_page - block.start, to);
+    segment = offset;
+  }
+  if (offset > segment)
+  {
+    visit(block.start + segment, buf.data() + segment, offset - segment);
+  }
+  return bytes;
+}
+
+// Reads a block and its overlap, and calls visit(address, data, length) for
+// every stretch that could be read. A page that fails to read, or that skip
+// leaves out, splits the block, so a scanner never sees memory that is not
+// really there. Returns the number of bytes read.
+template <typename Visitor>
+size_t read_block(ProcessMemory &proc, const ScanBlock &block, std::vector<unsigned char> &buf, PageSkip &skip, Visitor visit)
+{
+  const unsigned long long page = 4096;
+  size_t total = block.len + block.overlap;
+  if (buf.size() < total)
+  {
+    buf.resize(total);
+  }
+  if (!skip.active())
+  {
+    return read_stretch(proc, block, buf, 0, total, visit);
+  }
+
+  unsigned long long base = block.start & ~(page - 1);
+  size_t pages = (block.start + total - base + page - 1) / page;
+  thread_local std::vector<unsigned char> keep;
+  skip.select(base, pages, keep, block.start, block.start + block.len);
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < pages && !proc.exited;)
+  {
+    if (!keep[i])
+    {
+      ++i;
+      continue;
+    }
+    size_t first = i;
+    while (i < pages && keep[i])
+    {
+      ++i;
+    }
+    size_t from = first == 0 ? 0 : base + first * page - block.start;
+    size_t to = std::min<size_t>(base + i * page - block.start, total);
+    bytes += read_stretch(proc, block, buf, from, to, visit);
+  }
+  return bytes;
+}
+
+struct ScanStats
+{
+  unsigned long long bytes_scanned;
+  unsigned long long bytes_skipped;
+  size_t blocks;
+  double seconds;
+};
+
+// Finds the lowest address where the signature matches in the regions
+// selected by options, scanning blocks in parallel on the worker pool.
+// Blocks above an already found match are skipped.
+bool scan_regions(ProcessMemory &proc, const ProcessMaps &maps, const Signature &sig, const ScanOptions &options,
+                  unsigned long long &found_addr, ScanStats &stats, const std::atomic<bool> *cancelled)
+{
+  auto started = std::chrono::steady_clock::now();
+  std::vector<ScanBlock> blocks = plan_scan(maps, options, sig.size);
+  PageSkip skip(proc, maps, options);
+  std::atomic<unsigned long long> best(~0ULL);
+  std::atomic<unsigned long long> bytes(0);
+
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(blocks.size(), options.threads ? options.threads : pool.size() + 1, [&](size_t i)
+                    {
+    const ScanBlock &block = blocks[i];
+    if (block.start >= best || (cancelled && *cancelled) || proc.exited)
+    {
+      return;
+    }
+
+    thread_local std::vector<unsigned char> buf;
+    bytes += read_block(proc, block, buf, skip, [&](unsigned long long addr, const unsigned char *data, size_t len)
+                        {
+      long long hit = find_signature(data, len, block.start + block.len - addr, sig, options.kernel);
+      if (hit < 0)
+      {
+        return;
+      }
+      unsigned long long match = addr + hit;
+      unsigned long long current = best;
+      while (match < current && !best.compare_exchange_weak(current, match))
+      {
+      } }); });
+
+  stats.bytes_scanned = bytes;
+  stats.bytes_skipped = skip.skipped;
+  stats.blocks = blocks.size();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  found_addr = best;
+  if (proc.pidfd >= 0)
+  {
+    pidfd_exited(proc);
+  }
+  return found_addr != ~0ULL && !proc.exited;
+}
+
+void set_scan_stats(Napi::Env env, Napi::Object result, const ScanStats &stats)
+{
+  result.Set("bytesScanned", Napi::Number::New(env, stats.bytes_scanned));
+  result.Set("bytesSkipped", Napi::Number::New(env, stats.bytes_skipped));
+  result.Set("blocks", Napi::Number::New(env, stats.blocks));
+  result.Set("seconds", Napi::Number::New(env, stats.seconds));
+  result.Set("bytesPerSecond", Napi::Number::New(env, stats.seconds > 0 ? stats.bytes_scanned / stats.seconds : 0));
+}
+
+Napi::Object scan_result(Napi::Env env, bool found, unsigned long long address, const ScanStats &stats)
+{
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("address", found ? (Napi::Value)Napi::BigInt::New(env, (uint64_t)address) : env.Null());
+  set_scan_stats(env, result, stats);
+  return result;
+}
+
+// sigscan(pid, signature, options) scans the memory map: every region that
+// passes the filter in options (readable ones by default) is split into
+// blockSize pieces and scanned on threads pool threads.
+Napi::Value sigscan_regions(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  ScanOptions options;
+  if (!get_scan_options(info[2], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  std::shared_ptr<const Signature> sig = get_signature(env, info[1]);
+  if (!sig)
+  {
+    return env.Null();
+  }
+
+  unsigned long long address;
+  ScanStats stats;
+  bool found = scan_regions(*proc, *maps, *sig, options, address, stats, nullptr);
+  if (proc->exited)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return scan_result(env, found, address, stats);
+}
+
+Napi::Value compile_signature(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[0].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  AddonData *data = env.GetInstanceData<AddonData>();
+  return data->signature_handle.New({info[0]});
+}
+
+Napi::Value sigscan(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() >= 2 && is_signature(info[1]))
+  {
+    return sigscan_regions(info);
+  }
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long start_addr;
+  if (!get_address(info[1], start_addr) || !is_signature(info[2]))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  std::shared_ptr<const Signature> sig = get_signature(env, info[2]);
+  if (!sig)
+  {
+    return env.Null();
+  }
+
+  unsigned long long address;
+  if (scan_signature(*proc, start_addr, *sig, address, nullptr))
+  {
+    return Napi::Number::New(env, address);
+  }
+  else
+  {
+    return env.Null();
+  }
+}
+
+// A set of signatures matched together in one pass. Each signature is filed
+// under its rarest pair of adjacent fixed bytes, and the scanner looks every
+// position's byte pair up in a 64 Ki-bit bitmap before touching the buckets,
+// so the cost per byte barely depends on how many signatures there are.
+// Signatures without two adjacent fixed bytes are "loose" and matched one
+// by one with find_signature over the same buffer.
+struct SignatureSet
+{
+  struct Entry
+  {
+    unsigned key;
+    unsigned pattern;
+    size_t offset;
+  };
+
+  std::vector<Signature> sigs;
+  std::vector<Entry> entries;
+  std::vector<unsigned> bucket_start;
+  std::vector<unsigned> bitmap;
+  std::vector<unsigned> loose;
+  size_t max_size;
+  size_t max_offset;
+};
+
+void build_signature_set(SignatureSet &set)
+{
+  set.max_size = set.max_offset = 0;
+  std::vector<SignatureSet::Entry> entries;
+  for (size_t p = 0; p < set.sigs.size(); ++p)
+  {
+    const Signature &sig = set.sigs[p];
+    set.max_size = std::max(set.max_size, sig.size);
+
+    int best = -1;
+    for (size_t i = 0; i + 1 < sig.size; ++i)
+    {
+      if (sig.mask[i] && sig.mask[i + 1] &&
+          (best < 0 || byte_frequency(sig.bytes[i]) * byte_frequency(sig.bytes[i + 1]) <
+                           byte_frequency(sig.bytes[best]) * byte_frequency(sig.bytes[best + 1])))
+      {
+        best = i;
+      }
+    }
+    if (best < 0)
+    {
+      set.loose.push_back(p);
+      continue;
+    }
+    entries.push_back({(unsigned)(sig.bytes[best] | sig.bytes[best + 1] << 8), (unsigned)p, (size_t)best});
+    set.max_offset = std::max(set.max_offset, (size_t)best);
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const SignatureSet::Entry &a, const SignatureSet::Entry &b)
+            { return a.key < b.key; });
+  set.entries = entries;
+  set.bucket_start.assign(65537, 0);
+  set.bitmap.assign(65536 / 32, 0);
+  for (const SignatureSet::Entry &entry : entries)
+  {
+    set.bucket_start[entry.key + 1]++;
+    set.bitmap[entry.key >> 5] |= 1u << (entry.key & 31);
+  }
+  for (size_t k = 0; k < 65536; ++k)
+  {
+    set.bucket_start[k + 1] += set.bucket_start[k];
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Bit k is set when the byte pair at data + k is in the bitmap, for k < 64.
+// Looks up 8 pairs per gather; reads data[0, 65).
+__attribute__((target("avx2"))) unsigned long long pair_candidates_avx2(const unsigned char *data, const unsigned *bitmap)
+{
+  const __m256i low5 = _mm256_set1_epi32(31);
+  const __m256i one = _mm256_set1_epi32(1);
+  unsigned long long bits = 0;
+  for (int k = 0; k < 64; k += 8)
+  {
+    __m256i lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(data + k)));
+    __m256i hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(data + k + 1)));
+    __m256i key = _mm256_or_si256(lo, _mm256_slli_epi32(hi, 8));
+    __m256i word = _mm256_i32gather_epi32((const int *)bitmap, _mm256_srli_epi32(key, 5), 4);
+    __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(key, low5)), one);
+    bits |= (unsigned long long)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, one))) << k;
+  }
+  return bits;
+}
+#endif
+
+// Calls add(pattern, offset) for every match in data[0, len) that starts
+// before limit, at most max_matches times per pattern.
+template <typename Add>
+void find_signature_set(const unsigned char *data, size_t len, size_t limit, const SignatureSet &set,
+                        ScanKernel kernel, size_t max_matches, std::vector<size_t> &counts, Add add)
+{
+  size_t end = std::min(len, limit + set.max_offset);
+  auto check = [&](size_t i)
+  {
+    unsigned key = data[i] | data[i + 1] << 8;
+    if (!(set.bitmap[key >> 5] >> (key & 31) & 1))
+    {
+      return;
+    }
+    for (unsigned e = set.bucket_start[key]; e < set.bucket_start[key + 1]; ++e)
+    {
+      const SignatureSet::Entry &entry = set.entries[e];
+      const Signature &sig = set.sigs[entry.pattern];
+      if (i < entry.offset || counts[entry.pattern] >= max_matches)
+      {
+        continue;
+      }
+      size_t start = i - entry.offset;
+      if (start < limit && start + sig.size <= len && compare_bytes(data + start, sig))
+      {
+        counts[entry.pattern]++;
+        add(entry.pattern, start);
+      }
+    }
+  };
+
+  size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if ((kernel == KERNEL_AUTO ? best_scan_kernel() : kernel) == KERNEL_AVX2)
+  {
+    for (; i + 65 <= end; i += 64)
+    {
+      for (unsigned long long bits = pair_candidates_avx2(data + i, set.bitmap.data()); bits; bits &= bits - 1)
+      {
+        check(i + __builtin_ctzll(bits));
+      }
+    }
+  }
+#endif
+  for (; i + 1 < end; ++i)
+  {
+    check(i);
+  }
+
+  for (unsigned p : set.loose)
+  {
+    for (size_t from = 0; from < limit && counts[p] < max_matches;)
+    {
+      long long hit = find_signature(data + from, len - from, limit - from, set.sigs[p], kernel);
+      if (hit < 0)
+      {
+        break;
+      }
+      counts[p]++;
+      add(p, from + hit);
+      from += hit + 1;
+    }
+  }
+}
+
+// Reads every block once and matches all signatures against it. Returns
+// the matches of each signature in ascending order, at most max_matches.
+std::vector<std::vector<unsigned long long>> scan_regions_many(ProcessMemory &proc, const ProcessMaps &maps, const SignatureSet &set,
+                                                               const ScanOptions &options, size_t max_matches, ScanStats &stats)
+{
+  auto started = std::chrono::steady_clock::now();
+  std::vector<ScanBlock> blocks = plan_scan(maps, options, set.max_size);
+  PageSkip skip(proc, maps, options);
+  std::vector<std::vector<std::pair<unsigned, unsigned long long>>> found(blocks.size());
+  std::atomic<unsigned long long> bytes(0);
+
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(blocks.size(), options.threads ? options.threads : pool.size() + 1, [&](size_t i)
+                    {
+    const ScanBlock &block = blocks[i];
+    if (proc.exited)
+    {
+      return;
+    }
+
+    thread_local std::vector<unsigned char> buf;
+    std::vector<size_t> counts(set.sigs.size(), 0);
+    bytes += read_block(proc, block, buf, skip, [&](unsigned long long addr, const unsigned char *data, size_t len)
+                        {
+      if (addr >= block.start + block.len)
+      {
+        return;
+      }
+      find_signature_set(data, len, block.start + block.len - addr, set, options.kernel, max_matches, counts,
+                         [&](unsigned pattern, size_t offset)
+                         { found[i].push_back(std::make_pair(pattern, addr + offset)); }); }); });
+
+  std::vector<std::vector<unsigned long long>> matches(set.sigs.size());
+  for (const auto &block_found : found)
+  {
+    for (const auto &match : block_found)
+    {
+      matches[match.first].push_back(match.second);
+    }
+  }
+  for (auto &list : matches)
+  {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    if (list.size() > max_matches)
+    {
+      list.resize(max_matches);
+    }
+  }
+
+  stats.bytes_scanned = bytes;
+  stats.bytes_skipped = skip.skipped;
+  stats.blocks = blocks.size();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  if (proc.pidfd >= 0)
+  {
+    pidfd_exited(proc);
+  }
+  return matches;
+}
+
+// sigscan_many(pid, signatures, options) reads the selected regions once and
+// returns, for each signature, the addresses where it matches:
+// { matches: { [signature]: [BigInt, ...] }, bytesScanned, ... }. Takes the
+// same options as sigscan plus maxMatches, the cap per signature (1000).
+Napi::Value sigscan_many(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ScanOptions options;
+  if (!info[1].IsArray() || !get_scan_options(info[2], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t max_matches = 1000;
+  if (info[2].IsObject() && info[2].As<Napi::Object>().Has("maxMatches"))
+  {
+    max_matches = info[2].As<Napi::Object>().Get("maxMatches").ToNumber().Uint32Value();
+  }
+
+  Napi::Array patterns = info[1].As<Napi::Array>();
+  SignatureSet set;
+  for (uint32_t i = 0; i < patterns.Length(); ++i)
+  {
+    std::shared_ptr<const Signature> sig = get_signature(env, patterns.Get(i));
+    if (!sig)
+    {
+      return env.Null();
+    }
+    set.sigs.push_back(*sig);
+  }
+  build_signature_set(set);
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  ScanStats stats;
+  std::vector<std::vector<unsigned long long>> matches = scan_regions_many(*proc, *maps, set, options, max_matches, stats);
+  if (proc->exited)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object by_pattern = Napi::Object::New(env);
+  for (size_t p = 0; p < set.sigs.size(); ++p)
+  {
+    Napi::Array list = Napi::Array::New(env, matches[p].size());
+    for (size_t k = 0; k < matches[p].size(); ++k)
+    {
+      list.Set(k, Napi::BigInt::New(env, (uint64_t)matches[p][k]));
+    }
+    by_pattern.Set(set.sigs[p].source, list);
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("matches", by_pattern);
+  set_scan_stats(env, result, stats);
+  return result;
+}
+
+// Finds every match in the regions selected by options, up to
+// options.max_results, keeping only addresses aligned to options.alignment.
+// Blocks are scanned in parallel but emit(addresses, count) sees them in
+// address order: a finished block is held back until every block below it
+// has been passed on. Once max_results have been emitted, blocks not yet
+// started are skipped and truncated is set. Returns the number emitted.
+template <typename Emit>
+size_t scan_regions_all(ProcessMemory &proc, const ProcessMaps &maps, const Signature &sig, const ScanOptions &options,
+                        Emit emit, bool &truncated, ScanStats &stats, const std::atomic<bool> *cancelled)
+{
+  auto started = std::chrono::steady_clock::now();
+  std::vector<ScanBlock> blocks = plan_scan(maps, options, sig.size);
+  PageSkip skip(proc, maps, options);
+  std::vector<std::vector<unsigned long long>> found(blocks.size());
+  std::vector<unsigned char> done(blocks.size(), 0);
+  std::atomic<unsigned long long> bytes(0);
+  std::atomic<bool> full(options.max_results == 0);
+  std::mutex mutex;
+  size_t next = 0;
+  size_t total = 0;
+
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(blocks.size(), options.threads ? options.threads : pool.size() + 1, [&](size_t i)
+                    {
+    const ScanBlock &block = blocks[i];
+    std::vector<unsigned long long> &list = found[i];
+    if (!full && !(cancelled && *cancelled) && !proc.exited)
+    {
+      thread_local std::vector<unsigned char> buf;
+      bytes += read_block(proc, block, buf, skip, [&](unsigned long long addr, const unsigned char *data, size_t len)
+                          {
+        if (addr >= block.start + block.len)
+        {
+          return;
+        }
+        size_t limit = block.start + block.len - addr;
+        for (size_t from = 0; from < limit && list.size() < options.max_results;)
+        {
+          long long hit = find_signature(data + from, len - from, limit - from, sig, options.kernel);
+          if (hit < 0)
+          {
+            break;
+          }
+          unsigned long long match = addr + from + hit;
+          if (match % options.alignment == 0)
+          {
+            list.push_back(match);
+            from += hit + 1;
+          }
+          else
+          {
+            from = (match / options.alignment + 1) * options.alignment - addr;
+          }
+        } });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    done[i] = 1;
+    for (; next < blocks.size() && done[next]; ++next)
+    {
+      std::vector<unsigned long long> &ready = found[next];
+      size_t take = full ? 0 : std::min(ready.size(), options.max_results - total);
+      if (take > 0)
+      {
+        emit(ready.data(), take);
+        total += take;
+      }
+      if (total == options.max_results && !full)
+      {
+        full = true;
+        truncated = take < ready.size() || next + 1 < blocks.size();
+      }
+      std::vector<unsigned long long>().swap(ready);
+    } });
+
+  stats.bytes_scanned = bytes;
+  stats.bytes_skipped = skip.skipped;
+  stats.blocks = blocks.size();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  if (proc.pidfd >= 0)
+  {
+    pidfd_exited(proc);
+  }
+  return total;
+}
+
+// sigscan_all(pid, signature, options) returns every match instead of the
+// first, packed into a BigUint64Array in ascending order:
+// { addresses, count, truncated, bytesScanned, ... }. Takes the sigscan
+// options plus maxResults and alignment.
+Napi::Value sigscan_all(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ScanOptions options;
+  if (!is_signature(info[1]) || !get_scan_options(info[2], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<const Signature> sig = get_signature(env, info[1]);
+  if (!sig)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  std::vector<unsigned long long> addresses;
+  bool truncated = false;
+  ScanStats stats;
+  scan_regions_all(*proc, *maps, *sig, options, [&](const unsigned long long *found, size_t count)
+                   { addresses.insert(addresses.end(), found, found + count); }, truncated, stats, nullptr);
+  if (proc->exited)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::BigUint64Array array = Napi::BigUint64Array::New(env, addresses.size());
+  if (!addresses.empty())
+  {
+    memcpy(array.Data(), addresses.data(), addresses.size() * sizeof(uint64_t));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", array);
+  result.Set("count", Napi::Number::New(env, addresses.size()));
+  result.Set("truncated", Napi::Boolean::New(env, truncated));
+  set_scan_stats(env, result, stats);
+  return result;
+}
+
+// Value scanning: first_scan finds every slot in the writable regions whose
+// value passes a predicate, next_scan re-reads the survivors and narrows
+// them down. Candidates are kept per scan block, in whichever form is
+// smaller: a bitmap with one bit per slot plus a copy of the block, or the
+// slot numbers as LEB128 deltas plus their values packed back to back.
+enum ScanOp
+{
+  OP_ANY,
+  OP_EQ,
+  OP_NE,
+  OP_GT,
+  OP_LT,
+  OP_RANGE,
+  OP_CHANGED,
+  OP_UNCHANGED,
+  OP_INCREASED,
+  OP_DECREASED
+};
+
+struct ScanPredicate
+{
+  ScanOp op;
+  unsigned char value[8];
+  unsigned char max[8];
+};
+
+// Accepts a Number or BigInt (equal), one of "any", "changed",
+// "unchanged", "increased", "decreased", or { op, value } with op "eq",
+// "ne", "gt", "lt", or { op: "range", min, max }. Predicates comparing with
+// the previous value are not allowed in a first scan.
+bool get_scan_predicate(const Napi::Value &value, ValueType type, bool first, ScanPredicate &pred)
+{
+  static const char *names[] = {"any", "eq", "ne", "gt", "lt", "range", "changed", "unchanged", "increased", "decreased"};
+  memset(&pred, 0, sizeof(pred));
+  if (value.IsNumber() || value.IsBigInt())
+  {
+    pred.op = OP_EQ;
+    return value_from_js(value, type, pred.value);
+  }
+
+  std::string op;
+  Napi::Object object;
+  if (value.IsString())
+  {
+    op = value.As<Napi::String>().Utf8Value();
+  }
+  else if (value.IsObject() && value.As<Napi::Object>().Get("op").IsString())
+  {
+    object = value.As<Napi::Object>();
+    op = object.Get("op").As<Napi::String>().Utf8Value();
+  }
+  else
+  {
+    return false;
+  }
+
+  int index = -1;
+  for (int i = 0; i <= OP_DECREASED; ++i)
+  {
+    if (op == names[i])
+    {
+      index = i;
+    }
+  }
+  if (index < 0 || (first && index >= OP_CHANGED))
+  {
+    return false;
+  }
+  pred.op = static_cast<ScanOp>(index);
+
+  if (pred.op == OP_RANGE)
+  {
+    return !object.IsEmpty() && value_from_js(object.Get("min"), type, pred.value) && value_from_js(object.Get("max"), type, pred.max);
+  }
+  if (pred.op >= OP_EQ && pred.op <= OP_LT)
+  {
+    return !object.IsEmpty() && value_from_js(object.Get("value"), type, pred.value);
+  }
+  return true;
+}
+
+template <typename T>
+bool test_value(const ScanPredicate &pred, const unsigned char *data, const unsigned char *old)
+{
+  T current, target, previous;
+  memcpy(&current, data, sizeof(T));
+  memcpy(&target, pred.value, sizeof(T));
+  switch (pred.op)
+  {
+  case OP_ANY:
+    return true;
+  case OP_EQ:
+    return current == target;
+  case OP_NE:
+    return current != target;
+  case OP_GT:
+    return current > target;
+  case OP_LT:
+    return current < target;
+  case OP_RANGE:
+  {
+    T max;
+    memcpy(&max, pred.max, sizeof(T));
+    return current >= target && current <= max;
+  }
+  default:
+    break;
+  }
+  memcpy(&previous, old, sizeof(T));
+  switch (pred.op)
+  {
+  case OP_CHANGED:
+    return memcmp(data, old, sizeof(T)) != 0;
+  case OP_UNCHANGED:
+    return memcmp(data, old, sizeof(T)) == 0;
+  case OP_INCREASED:
+    return current > previous;
+  default:
+    return current < previous;
+  }
+}
+
+typedef bool (*ValueTest)(const ScanPredicate &, const unsigned char *, const unsigned char *);
+
+ValueTest value_test(ValueType type)
+{
+  switch (type)
+  {
+  case TYPE_I8:
+    return test_value<int8_t>;
+  case TYPE_U8:
+    return test_value<uint8_t>;
+  case TYPE_I16:
+    return test_value<int16_t>;
+  case TYPE_U16:
+    return test_value<uint16_t>;
+  case TYPE_I32:
+    return test_value<int32_t>;
+  case TYPE_U32:
+    return test_value<uint32_t>;
+  case TYPE_I64:
+    return test_value<int64_t>;
+  case TYPE_U64:
+    return test_value<uint64_t>;
+  case TYPE_F32:
+    return test_value<float>;
+  default:
+    return test_value<double>;
+  }
+}
+
+// The candidates inside one scan block. Slot k is the value at
+// start + k * alignment.
+struct CandidateBlock
+{
+  unsigned long long start;
+  size_t len;
+  size_t count;
+  bool dense;
+  std::vector<unsigned long long> bitmap;
+  std::vector<unsigned char> deltas;
+  std::vector<unsigned char> values;
+
+  size_t storage() const
+  {
+    return bitmap.size() * sizeof(unsigned long long) + deltas.size() + values.size();
+  }
+
+  // Calls fn(offset, value) for every candidate, in ascending order, with
+  // offset relative to start and value the bytes seen by the last scan.
+  template <typename Fn>
+  void for_each(size_t alignment, size_t size, Fn fn) const
+  {
+    if (dense)
+    {
+      for (size_t w = 0; w < bitmap.size(); ++w)
+      {
+        for (unsigned long long bits = bitmap[w]; bits; bits &= bits - 1)
+        {
+          size_t offset = (w * 64 + __builtin_ctzll(bits)) * alignment;
+          fn(offset, values.data() + offset);
+        }
+      }
+      return;
+    }
+    size_t slot = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < deltas.size(); ++k)
+    {
+      size_t delta = 0;
+      for (int shift = 0;; shift += 7)
+      {
+        unsigned char byte = deltas[i++];
+        delta |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+          break;
+        }
+      }
+      slot += delta;
+      fn(slot * alignment, values.data() + k * size);
+    }
+  }
+
+  // Starts an empty dense set: scans fill in the bitmap and values, set
+  // count, then call compact.
+  void make_dense(size_t alignment, size_t size)
+  {
+    dense = true;
+    count = 0;
+    std::vector<unsigned char>().swap(deltas);
+    bitmap.assign(((len + alignment - 1) / alignment + 63) / 64, 0);
+    values.resize(len + size);
+  }
+
+  // Switches a dense set to the sparse form if that takes less memory.
+  void compact(size_t alignment, size_t size)
+  {
+    if (!dense || count * (size + 2) > values.size() + bitmap.size() * sizeof(unsigned long long))
+    {
+      return;
+    }
+    std::vector<uint32_t> offsets;
+    std::vector<unsigned char> found;
+    for_each(alignment, size, [&](size_t offset, const unsigned char *value)
+             {
+      offsets.push_back(offset);
+      found.insert(found.end(), value, value + size); });
+    store(offsets, found, alignment);
+  }
+
+  // Replaces the candidates with a sparse set of offsets, whose values are
+  // packed in found.
+  void store(const std::vector<uint32_t> &offsets, std::vector<unsigned char> &found, size_t alignment)
+  {
+    dense = false;
+    count = offsets.size();
+    std::vector<unsigned long long>().swap(bitmap);
+    std::vector<unsigned char>().swap(deltas);
+    values.swap(found);
+    values.shrink_to_fit();
+    size_t previous = 0;
+    for (uint32_t offset : offsets)
+    {
+      size_t delta = offset / alignment - previous;
+      previous = offset / alignment;
+      do
+      {
+        deltas.push_back((delta & 0x7f) | (delta >= 0x80 ? 0x80 : 0));
+        delta >>= 7;
+      } while (delta);
+    }
+    deltas.shrink_to_fit();
+  }
+};
+
+struct ValueScanStats
+{
+  unsigned long long bytes_read;
+  unsigned long long bytes_skipped;
+  double seconds;
+};
+
+// A first_scan result, narrowed in place by next_scan.
+class ValueScan : public Napi::ObjectWrap<ValueScan>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "ValueScan",
+                       {InstanceAccessor("count", &ValueScan::get_count, nullptr),
+                        InstanceMethod("addresses", &ValueScan::get_addresses),
+                        InstanceMethod("values", &ValueScan::get_values),
+                        InstanceMethod("stats", &ValueScan::get_stats)});
+  }
+
+  ValueScan(const Napi::CallbackInfo &info) : Napi::ObjectWrap<ValueScan>(info), type(TYPE_I32), alignment(4), threads(0)
+  {
+    last.bytes_read = 0;
+    last.bytes_skipped = 0;
+    last.seconds = 0;
+  }
+
+  size_t count() const
+  {
+    size_t total = 0;
+    for (const CandidateBlock &block : blocks)
+    {
+      total += block.count;
+    }
+    return total;
+  }
+
+  std::shared_ptr<ProcessMemory> proc;
+  ValueType type;
+  size_t alignment;
+  size_t threads;
+  std::vector<CandidateBlock> blocks;
+  ValueScanStats last;
+
+private:
+  Napi::Value get_count(const Napi::CallbackInfo &info)
+  {
+    return Napi::Number::New(info.Env(), count());
+  }
+
+  size_t get_limit(const Napi::CallbackInfo &info)
+  {
+    size_t total = count();
+    return info.Length() > 0 && info[0].IsNumber() ? std::min<size_t>(total, info[0].As<Napi::Number>().Int64Value()) : total;
+  }
+
+  // addresses(limit) returns the first limit candidates as a BigUint64Array.
+  Napi::Value get_addresses(const Napi::CallbackInfo &info)
+  {
+    size_t limit = get_limit(info);
+    Napi::BigUint64Array array = Napi::BigUint64Array::New(info.Env(), limit);
+    size_t k = 0;
+    for (const CandidateBlock &block : blocks)
+    {
+      if (k == limit)
+      {
+        break;
+      }
+      block.for_each(alignment, value_type_size(type), [&](size_t offset, const unsigned char *)
+                     {
+        if (k < limit)
+        {
+          array[k++] = block.start + offset;
+        } });
+    }
+    return array;
+  }
+
+  // values(limit) returns the values the last scan saw, in the same order.
+  Napi::Value get_values(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    size_t limit = get_limit(info);
+    Napi::Array array = Napi::Array::New(env, limit);
+    size_t k = 0;
+    for (const CandidateBlock &block : blocks)
+    {
+      if (k == limit)
+      {
+        break;
+      }
+      block.for_each(alignment, value_type_size(type), [&](size_t, const unsigned char *value)
+                     {
+        if (k < limit)
+        {
+          array.Set(k++, value_to_js(env, type, value));
+        } });
+    }
+    return array;
+  }
+
+  Napi::Value get_stats(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    size_t dense = 0;
+    size_t storage = 0;
+    for (const CandidateBlock &block : blocks)
+    {
+      dense += block.dense;
+      storage += block.storage();
+    }
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, count()));
+    result.Set("denseBlocks", Napi::Number::New(env, dense));
+    result.Set("sparseBlocks", Napi::Number::New(env, blocks.size() - dense));
+    result.Set("storageBytes", Napi::Number::New(env, storage));
+    result.Set("bytesRead", Napi::Number::New(env, last.bytes_read));
+    result.Set("bytesSkipped", Napi::Number::New(env, last.bytes_skipped));
+    result.Set("seconds", Napi::Number::New(env, last.seconds));
+    return result;
+  }
+};
+
+// Reads every slot of the selected regions and keeps those passing pred.
+void first_value_scan(ValueScan &scan, const ProcessMaps &maps, const ScanOptions &options, const ScanPredicate &pred)
+{
+  auto started = std::chrono::steady_clock::now();
+  size_t size = value_type_size(scan.type);
+  ValueTest test = value_test(scan.type);
+  std::vector<ScanBlock> blocks = plan_scan(maps, options, size);
+  PageSkip skip(*scan.proc, maps, options);
+  std::vector<CandidateBlock> found(blocks.size());
+  std::atomic<unsigned long long> bytes(0);
+
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(blocks.size(), scan.threads ? scan.threads : pool.size() + 1, [&](size_t i)
+                    {
+    const ScanBlock &block = blocks[i];
+    CandidateBlock &candidates = found[i];
+    candidates.start = block.start;
+    candidates.len = block.len;
+    candidates.count = 0;
+    if (scan.proc->exited)
+    {
+      return;
+    }
+
+    // Reads straight into the block's value copy.
+    candidates.make_dense(scan.alignment, size);
+    std::vector<unsigned char> &buf = candidates.values;
+    bytes += read_block(*scan.proc, block, buf, skip, [&](unsigned long long addr, const unsigned char *data, size_t len)
+                        {
+      size_t first = (addr - block.start + scan.alignment - 1) / scan.alignment * scan.alignment;
+      for (size_t offset = first; offset < block.len && offset + size <= addr - block.start + len; offset += scan.alignment)
+      {
+        if (test(pred, buf.data() + offset, buf.data() + offset))
+        {
+          size_t slot = offset / scan.alignment;
+          candidates.bitmap[slot / 64] |= 1ULL << (slot % 64);
+          candidates.count++;
+        }
+      } });
+    candidates.compact(scan.alignment, size); });
+
+  scan.blocks.clear();
+  for (CandidateBlock &block : found)
+  {
+    if (block.count > 0)
+    {
+      scan.blocks.push_back(std::move(block));
+    }
+  }
+  scan.last.bytes_read = bytes;
+  scan.last.bytes_skipped = skip.skipped;
+  scan.last.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+// Re-reads only the pages that still hold candidates, and keeps the
+// candidates passing pred. A page that can no longer be read drops its
+// candidates.
+void next_value_scan(ValueScan &scan, const ScanPredicate &pred)
+{
+  const size_t page = 4096;
+  auto started = std::chrono::steady_clock::now();
+  size_t size = value_type_size(scan.type);
+  ValueTest test = value_test(scan.type);
+  std::atomic<unsigned long long> bytes(0);
+
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(scan.blocks.size(), scan.threads ? scan.threads : pool.size() + 1, [&](size_t i)
+                    {
+    CandidateBlock &block = scan.blocks[i];
+    if (scan.proc->exited)
+    {
+      return;
+    }
+
+    // Pages are counted from the one holding block.start.
+    unsigned long long base = block.start & ~(unsigned long long)(page - 1);
+    size_t pages = (block.start + block.len + size - base + page - 1) / page;
+    std::vector<unsigned char> wanted(pages, 0);
+    block.for_each(scan.alignment, size, [&](size_t offset, const unsigned char *)
+                   {
+      unsigned long long addr = block.start + offset;
+      wanted[(addr - base) / page] = 1;
+      wanted[(addr + size - 1 - base) / page] = 1; });
+
+    thread_local std::vector<unsigned char> buf;
+    if (buf.size() < pages * page)
+    {
+      buf.resize(pages * page);
+    }
+    std::vector<unsigned char> readable(pages, 0);
+    for (size_t p = 0; p < pages;)
+    {
+      if (!wanted[p])
+      {
+        ++p;
+        continue;
+      }
+      size_t end = p;
+      while (end < pages && wanted[end])
+      {
+        ++end;
+      }
+      ssize_t n = read_span(*scan.proc, base + p * page, buf.data() + p * page, (end - p) * page);
+      size_t whole = n > 0 ? n / page : 0;
+      bytes += n > 0 ? n : 0;
+      memset(readable.data() + p, 1, whole);
+      // Skip past the page that failed and carry on with the rest.
+      p += whole + (p + whole < end ? 1 : 0);
+    }
+
+    std::vector<uint32_t> offsets;
+    std::vector<unsigned char> values;
+    size_t survivors = 0;
+    block.for_each(scan.alignment, size, [&](size_t offset, const unsigned char *old)
+                   {
+      unsigned long long addr = block.start + offset;
+      const unsigned char *value = buf.data() + (addr - base);
+      bool keep = readable[(addr - base) / page] && readable[(addr + size - 1 - base) / page] && test(pred, value, old);
+      if (block.dense)
+      {
+        // Dense sets are narrowed in place.
+        size_t slot = offset / scan.alignment;
+        if (keep)
+        {
+          memcpy(block.values.data() + offset, value, size);
+          survivors++;
+        }
+        else
+        {
+          block.bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+        }
+      }
+      else if (keep)
+      {
+        offsets.push_back(offset);
+        values.insert(values.end(), value, value + size);
+      }
+    });
+    if (block.dense)
+    {
+      block.count = survivors;
+      block.compact(scan.alignment, size);
+    }
+    else
+    {
+      block.store(offsets, values, scan.alignment);
+    } });
+
+  scan.blocks.erase(std::remove_if(scan.blocks.begin(), scan.blocks.end(), [](const CandidateBlock &block)
+                                   { return block.count == 0; }),
+                    scan.blocks.end());
+  scan.last.bytes_read = bytes;
+  scan.last.bytes_skipped = 0;
+  scan.last.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+// first_scan(pid, type, predicate, options) scans the writable regions (or
+// those chosen by the region filter in options) for values of type passing
+// predicate, at every multiple of alignment (the type's size by default),
+// and returns a ValueScan holding the candidates.
+Napi::Value first_scan(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ValueType type;
+  ScanPredicate pred;
+  ScanOptions options;
+  options.filter.perms = "rw";
+  if (!info[1].IsString() || !parse_value_type(info[1].As<Napi::String>(), type) ||
+      !get_scan_predicate(info[2], type, true, pred) || !get_scan_options(info[3], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t alignment = value_type_size(type);
+  if (info[3].IsObject() && info[3].As<Napi::Object>().Has("alignment"))
+  {
+    alignment = options.alignment;
+  }
+  if (alignment > 4096 || 4096 % alignment != 0)
+  {
+    Napi::RangeError::New(env, "alignment must divide the page size").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  AddonData *data = env.GetInstanceData<AddonData>();
+  Napi::Object handle = data->value_scan.New({});
+  ValueScan *scan = ValueScan::Unwrap(handle);
+  scan->proc = proc;
+  scan->type = type;
+  scan->alignment = alignment;
+  scan->threads = options.threads;
+  first_value_scan(*scan, *maps, options, pred);
+  if (proc->exited)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return handle;
+}
+
+// next_scan(scan, predicate) narrows a ValueScan to the candidates passing
+// predicate, which may compare with the value seen by the previous scan.
+// Returns the number left.
+Napi::Value next_scan(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  AddonData *data = env.GetInstanceData<AddonData>();
+  if (!info[0].IsObject() || !info[0].As<Napi::Object>().InstanceOf(data->value_scan.Value()))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  ValueScan *scan = ValueScan::Unwrap(info[0].As<Napi::Object>());
+  ScanPredicate pred;
+  if (!scan->proc || !get_scan_predicate(info[1], scan->type, false, pred))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  next_value_scan(*scan, pred);
+  if (scan->proc->exited)
+  {
+    Napi::Error::New(env, "Process " + std::to_string(scan->proc->pid) + " has exited").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Number::New(env, scan->count());
+}
+
+// Snapshots: a copy of the selected regions kept in local mmap'd layers,
+// with one pointer per page. take_snapshot resets the target's soft-dirty
+// bits (clear_refs 4) and copies everything; refresh() reads pagemap and
+// copies only the pages whose soft-dirty bit (55) has been set since, into
+// a new layer. Clean pages keep pointing into the older layers, so
+// snapshots taken in a row share their storage and diff_snapshots can skip
+// any page both point to.
+const size_t snapshot_page = 4096;
+const size_t snapshot_max_layers = 8;
+
+struct SnapshotLayer
+{
+  unsigned char *data;
+  size_t size;
+
+  SnapshotLayer() : data(nullptr), size(0) {}
+
+  ~SnapshotLayer()
+  {
+    if (data)
+    {
+      munmap(data, size);
+    }
+  }
+
+  // Anonymous memory, or an unlinked file in dir so the cache can be paged
+  // out to disk instead of swap. Nothing is committed up front, so a
+  // generous upper bound only costs the pages actually written.
+  bool map(size_t bytes, const std::string &dir, std::string &error)
+  {
+    if (bytes == 0)
+    {
+      return true;
+    }
+    int fd = -1;
+    if (!dir.empty())
+    {
+      fd = open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+      if (fd < 0 || ftruncate(fd, bytes) != 0)
+      {
+        error = "Could not create a cache file in " + dir + ": " + strerror(errno);
+        if (fd >= 0)
+        {
+          close(fd);
+        }
+        return false;
+      }
+    }
+    void *mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, fd, 0);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    if (mapped == MAP_FAILED)
+    {
+      error = std::string("Could not map the cache: ") + strerror(errno);
+      return false;
+    }
+    data = (unsigned char *)mapped;
+    size = bytes;
+    return true;
+  }
+};
+
+struct SnapshotRegion
+{
+  unsigned long long start;
+  unsigned long long end;
+  size_t first_page;
+};
+
+struct SnapshotData
+{
+  std::shared_ptr<ProcessMemory> proc;
+  RegionFilter filter;
+  std::string cache_dir;
+  std::vector<SnapshotRegion> regions;
+  // nullptr for pages that could not be read.
+  std::vector<const unsigned char *> pages;
+  std::vector<std::shared_ptr<SnapshotLayer>> layers;
+  // The soft-dirty reset this snapshot was taken after, 0 if it could not
+  // reset the bits.
+  unsigned long long generation;
+  size_t pages_read;
+  double seconds;
+
+  const unsigned char *const *page_at(unsigned long long addr) const
+  {
+    auto it = std::upper_bound(regions.begin(), regions.end(), addr, [](unsigned long long a, const SnapshotRegion &region)
+                               { return a < region.end; });
+    if (it == regions.end() || addr < it->start)
+    {
+      return nullptr;
+    }
+    return &pages[it->first_page + (addr - it->start) / snapshot_page];
+  }
+
+  // Index of the layer holding page.
+  size_t layer_of(const unsigned char *page) const
+  {
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+      if (page >= layers[i]->data && page < layers[i]->data + layers[i]->size)
+      {
+        return i;
+      }
+    }
+    return 0;
+  }
+};
+
+// Soft-dirty bits belong to the whole process, so a reset by one snapshot
+// invalidates what another would read from pagemap. Each reset bumps the
+// generation of the process; only the snapshot holding the latest one may
+// trust the bits.
+std::mutex soft_dirty_mutex;
+std::map<std::pair<pid_t, unsigned long long>, unsigned long long> soft_dirty_generations;
+
+unsigned long long soft_dirty_generation(const ProcessMemory &proc)
+{
+  std::lock_guard<std::mutex> lock(soft_dirty_mutex);
+  auto it = soft_dirty_generations.find(std::make_pair(proc.pid, proc.start_time));
+  return it == soft_dirty_generations.end() ? 0 : it->second;
+}
+
+// Kernels built without CONFIG_MEM_SOFT_DIRTY accept clear_refs 4 but never
+// set bit 55, which would make every page look clean. A page in a fresh
+// mapping is always soft-dirty where tracking works.
+bool soft_dirty_supported()
+{
+  static const bool supported = []
+  {
+    void *probe = mmap(nullptr, snapshot_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (probe == MAP_FAILED)
+    {
+      return false;
+    }
+    *(volatile unsigned char *)probe = 1;
+    uint64_t entry = 0;
+    int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      if (pread(fd, &entry, sizeof(entry), (unsigned long long)probe / snapshot_page * sizeof(entry)) != sizeof(entry))
+      {
+        entry = 0;
+      }
+      close(fd);
+    }
+    munmap(probe, snapshot_page);
+    return (entry >> 55 & 1) != 0;
+  }();
+  return supported;
+}
+
+// Returns the new generation, or 0 if the bits could not be reset.
+unsigned long long clear_soft_dirty(const ProcessMemory &proc)
+{
+  if (!soft_dirty_supported())
+  {
+    return 0;
+  }
+  std::string path = "/proc/" + std::to_string(proc.pid) + "/clear_refs";
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return 0;
+  }
+  bool ok = write(fd, "4", 1) == 1;
+  close(fd);
+  if (!ok)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(soft_dirty_mutex);
+  return ++soft_dirty_generations[std::make_pair(proc.pid, proc.start_time)];
+}
+
+// Builds a snapshot of the regions selected by filter. With a parent whose
+// soft-dirty generation is still current, pages the parent holds and that
+// pagemap reports clean are shared instead of read.
+std::shared_ptr<SnapshotData> build_snapshot(std::shared_ptr<ProcessMemory> proc, const ProcessMaps &maps, const RegionFilter &filter,
+                                             const std::string &cache_dir, const SnapshotData *parent, std::string &error)
+{
+  auto started = std::chrono::steady_clock::now();
+  std::shared_ptr<SnapshotData> snapshot = std::make_shared<SnapshotData>();
+  snapshot->proc = proc;
+  snapshot->filter = filter;
+  snapshot->cache_dir = cache_dir;
+
+  for (const auto &span : filter_spans(maps, filter))
+  {
+    SnapshotRegion region;
+    region.start = span.first & ~(unsigned long long)(snapshot_page - 1);
+    region.end = (span.second + snapshot_page - 1) & ~(unsigned long long)(snapshot_page - 1);
+    region.first_page = snapshot->pages.size();
+    snapshot->regions.push_back(region);
+    snapshot->pages.resize(snapshot->pages.size() + (region.end - region.start) / snapshot_page, nullptr);
+  }
+
+  // Decide which pages to read.
+  bool incremental = parent && parent->generation != 0 && parent->generation == soft_dirty_generation(*proc);
+  std::vector<unsigned char> wanted(snapshot->pages.size(), 1);
+  if (incremental)
+  {
+    std::string path = "/proc/" + std::to_string(proc->pid) + "/pagemap";
+    int pagemap = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    std::vector<uint64_t> entries;
+    for (const SnapshotRegion &region : snapshot->regions)
+    {
+      size_t count = (region.end - region.start) / snapshot_page;
+      entries.assign(count, ~0ULL);
+      if (pagemap >= 0)
+      {
+        ssize_t n = pread(pagemap, entries.data(), count * sizeof(uint64_t), region.start / snapshot_page * sizeof(uint64_t));
+        if (n < 0)
+        {
+          entries.assign(count, ~0ULL);
+        }
+      }
+      for (size_t k = 0; k < count; ++k)
+      {
+        const unsigned char *const *old = parent->page_at(region.start + k * snapshot_page);
+        if (old && *old && !(entries[k] >> 55 & 1))
+        {
+          snapshot->pages[region.first_page + k] = *old;
+          wanted[region.first_page + k] = 0;
+        }
+      }
+    }
+    if (pagemap >= 0)
+    {
+      close(pagemap);
+    }
+  }
+
+  // Shared pages keep the parent's layers alive. Only the layers some page
+  // still points into are carried over, and once there are too many of
+  // them or they hold more dead pages than live ones, the shared pages are
+  // copied forward into the new layer instead, so a long refresh loop does
+  // not grow without bound.
+  std::vector<size_t> live(incremental ? parent->layers.size() : 0, 0);
+  size_t shared = 0;
+  size_t parent_bytes = 0;
+  for (size_t i = 0; incremental && i < snapshot->pages.size(); ++i)
+  {
+    if (!wanted[i])
+    {
+      live[parent->layer_of(snapshot->pages[i])]++;
+      shared++;
+    }
+  }
+  for (size_t i = 0; i < live.size(); ++i)
+  {
+    parent_bytes += parent->layers[i]->size;
+  }
+  bool compact = shared > 0 && ((size_t)std::count_if(live.begin(), live.end(), [](size_t n)
+                                              { return n > 0; }) >= snapshot_max_layers ||
+                                parent_bytes - shared * snapshot_page > shared * snapshot_page);
+
+  // Reset the bits before copying, so writes racing with the copy show up
+  // next time.
+  snapshot->generation = clear_soft_dirty(*proc);
+
+  size_t count = std::count(wanted.begin(), wanted.end(), 1);
+  std::shared_ptr<SnapshotLayer> layer = std::make_shared<SnapshotLayer>();
+  if (!layer->map((count + (compact ? shared : 0)) * snapshot_page, cache_dir, error))
+  {
+    return nullptr;
+  }
+
+  // Contiguous wanted pages are read as one range, all ranges in as few
+  // process_vm_readv calls as possible. A range that fails is retried page
+  // by page.
+  std::vector<MemoryRange> ranges;
+  std::vector<size_t> range_pages;
+  size_t slot = 0;
+  for (const SnapshotRegion &region : snapshot->regions)
+  {
+    size_t region_pages = (region.end - region.start) / snapshot_page;
+    for (size_t k = 0; k < region_pages; ++k)
+    {
+      size_t page = region.first_page + k;
+      if (!wanted[page])
+      {
+        continue;
+      }
+      if (!ranges.empty() && range_pages.back() + ranges.back().len / snapshot_page == page &&
+          ranges.back().addr + ranges.back().len == region.start + k * snapshot_page)
+      {
+        ranges.back().len += snapshot_page;
+      }
+      else
+      {
+        ranges.push_back({region.start + k * snapshot_page, layer->data + slot * snapshot_page, snapshot_page});
+        range_pages.push_back(page);
+      }
+      ++slot;
+    }
+  }
+  std::vector<unsigned char> ok(ranges.size());
+  read_ranges(*proc, ranges.data(), ranges.size(), ok.data());
+  for (size_t r = 0; r < ranges.size(); ++r)
+  {
+    for (size_t k = 0; k < ranges[r].len / snapshot_page; ++k)
+    {
+      unsigned char *buf = (unsigned char *)ranges[r].buf + k * snapshot_page;
+      if (ok[r] || read_span(*proc, ranges[r].addr + k * snapshot_page, buf, snapshot_page) == (ssize_t)snapshot_page)
+      {
+        snapshot->pages[range_pages[r] + k] = buf;
+      }
+    }
+  }
+
+  if (compact)
+  {
+    for (size_t i = 0; i < snapshot->pages.size(); ++i)
+    {
+      if (!wanted[i])
+      {
+        unsigned char *buf = layer->data + slot++ * snapshot_page;
+        memcpy(buf, snapshot->pages[i], snapshot_page);
+        snapshot->pages[i] = buf;
+      }
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+      if (live[i] > 0)
+      {
+        snapshot->layers.push_back(parent->layers[i]);
+      }
+    }
+  }
+  if (layer->data)
+  {
+    snapshot->layers.push_back(layer);
+  }
+  snapshot->pages_read = count;
+  snapshot->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return snapshot;
+}
+
+class Snapshot : public Napi::ObjectWrap<Snapshot>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "Snapshot",
+                       {InstanceMethod("refresh", &Snapshot::refresh),
+                        InstanceMethod("read", &Snapshot::read),
+                        InstanceMethod("stats", &Snapshot::get_stats),
+                        InstanceMethod("close", &Snapshot::close_snapshot)});
+  }
+
+  Snapshot(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Snapshot>(info) {}
+
+  static Napi::Value wrap(Napi::Env env, std::shared_ptr<SnapshotData> data)
+  {
+    Napi::Object handle = env.GetInstanceData<AddonData>()->snapshot.New({});
+    Unwrap(handle)->data = data;
+    return handle;
+  }
+
+  std::shared_ptr<SnapshotData> data;
+
+private:
+  // refresh() returns a new snapshot of the same regions, re-reading only
+  // the pages written since this one was taken when the kernel tracks
+  // soft-dirty bits and no other snapshot of the process has reset them.
+  Napi::Value refresh(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    if (!data)
+    {
+      Napi::Error::New(env, "Snapshot is closed").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::shared_ptr<const ProcessMaps> maps = get_maps(data->proc->pid, MAPS_RELOAD);
+    if (!maps || !process_alive(*data->proc))
+    {
+      Napi::Error::New(env, "Process " + std::to_string(data->proc->pid) + " has exited").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    std::string error;
+    std::shared_ptr<SnapshotData> next = build_snapshot(data->proc, *maps, data->filter, data->cache_dir, data.get(), error);
+    if (!next)
+    {
+      Napi::Error::New(env, error).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    return wrap(env, next);
+  }
+
+  // read(address, length) returns the snapshot's copy as a Buffer, or null
+  // if any of it is not in the snapshot.
+  Napi::Value read(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    unsigned long long addr;
+    if (info.Length() < 2 || !get_address(info[0], addr) || !info[1].IsNumber())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    size_t len;
+    if (!get_length(env, info[1], len))
+    {
+      return env.Null();
+    }
+    Napi::Buffer<unsigned char> buffer = Napi::Buffer<unsigned char>::New(env, len);
+    for (size_t done = 0; data && done < len;)
+    {
+      unsigned long long at = addr + done;
+      const unsigned char *const *page = data->page_at(at);
+      if (!page || !*page)
+      {
+        return env.Null();
+      }
+      size_t offset = at % snapshot_page;
+      size_t n = std::min(len - done, snapshot_page - offset);
+      memcpy(buffer.Data() + done, *page + offset, n);
+      done += n;
+    }
+    return data ? (Napi::Value)buffer : env.Null();
+  }
+
+  Napi::Value get_stats(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    if (!data)
+    {
+      return result;
+    }
+    size_t present = std::count_if(data->pages.begin(), data->pages.end(), [](const unsigned char *page)
+                                   { return page != nullptr; });
+    size_t layer_bytes = 0;
+    for (const auto &layer : data->layers)
+    {
+      layer_bytes += layer->size;
+    }
+    result.Set("pages", Napi::Number::New(env, present));
+    result.Set("pagesRead", Napi::Number::New(env, data->pages_read));
+    result.Set("bytesRead", Napi::Number::New(env, (double)data->pages_read * snapshot_page));
+    result.Set("softDirty", Napi::Boolean::New(env, data->generation != 0));
+    result.Set("layers", Napi::Number::New(env, data->layers.size()));
+    result.Set("cacheBytes", Napi::Number::New(env, layer_bytes));
+    result.Set("seconds", Napi::Number::New(env, data->seconds));
+    return result;
+  }
+
+  Napi::Value close_snapshot(const Napi::CallbackInfo &info)
+  {
+    data.reset();
+    return info.Env().Null();
+  }
+};
+
+// take_snapshot(pid, options) copies the regions selected by the region
+// filter in options (writable ones by default) into a Snapshot. cacheDir
+// keeps the copy in an unlinked file there instead of anonymous memory.
+Napi::Value take_snapshot(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RegionFilter filter;
+  filter.perms = "rw";
+  std::string cache_dir;
+  if (!get_region_filter(info[1], filter))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (info[1].IsObject() && info[1].As<Napi::Object>().Get("cacheDir").IsString())
+  {
+    cache_dir = info[1].As<Napi::Object>().Get("cacheDir").As<Napi::String>().Utf8Value();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_RELOAD);
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  std::string error;
+  std::shared_ptr<SnapshotData> snapshot = build_snapshot(proc, *maps, filter, cache_dir, nullptr, error);
+  if (!snapshot)
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Snapshot::wrap(env, snapshot);
+}
+
+// Calls emit(address, length) for every run of bytes that differs between
+// the snapshots, or for every differing page when by_page is set. A page
+// present in only one snapshot differs as a whole.
+template <typename Emit>
+void diff_snapshot_data(const SnapshotData &a, const SnapshotData &b, bool by_page, Emit emit)
+{
+  std::vector<std::pair<unsigned long long, const unsigned char *>> pa, pb;
+  for (const SnapshotData *data : {&a, &b})
+  {
+    auto &out = data == &a ? pa : pb;
+    for (const SnapshotRegion &region : data->regions)
+    {
+      for (unsigned long long addr = region.start; addr < region.end; addr += snapshot_page)
+      {
+        const unsigned char *page = data->pages[region.first_page + (addr - region.start) / snapshot_page];
+        if (page)
+        {
+          out.push_back(std::make_pair(addr, page));
+        }
+      }
+    }
+  }
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < pa.size() || j < pb.size())
+  {
+    unsigned long long addr;
+    const unsigned char *x = nullptr;
+    const unsigned char *y = nullptr;
+    if (j == pb.size() || (i < pa.size() && pa[i].first < pb[j].first))
+    {
+      addr = pa[i++].first;
+    }
+    else if (i == pa.size() || pb[j].first < pa[i].first)
+    {
+      addr = pb[j++].first;
+    }
+    else
+    {
+      addr = pa[i].first;
+      x = pa[i++].second;
+      y = pb[j++].second;
+      if (x == y || memcmp(x, y, snapshot_page) == 0)
+      {
+        continue;
+      }
+    }
+
+    if (by_page || !x)
+    {
+      emit(addr, snapshot_page);
+      continue;
+    }
+    for (size_t k = 0; k < snapshot_page;)
+    {
+      if (x[k] == y[k])
+      {
+        ++k;
+        continue;
+      }
+      size_t end = k;
+      while (end < snapshot_page && x[end] != y[end])
+      {
+        ++end;
+      }
+      emit(addr + k, end - k);
+      k = end;
+    }
+  }
+}
+
+// diff_snapshots(a, b, { granularity: "byte" | "page" }) returns what
+// changed from a to b as { addresses: BigUint64Array, lengths: Uint32Array }:
+// runs of differing bytes, or runs of whole pages that differ. Runs are
+// merged across page boundaries.
+Napi::Value diff_snapshots(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  AddonData *addon = env.GetInstanceData<AddonData>();
+  for (size_t i = 0; i < 2; ++i)
+  {
+    if (!info[i].IsObject() || !info[i].As<Napi::Object>().InstanceOf(addon->snapshot.Value()))
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  bool by_page = false;
+  if (info[2].IsObject() && info[2].As<Napi::Object>().Get("granularity").IsString())
+  {
+    std::string granularity = info[2].As<Napi::Object>().Get("granularity").As<Napi::String>().Utf8Value();
+    if (granularity != "byte" && granularity != "page")
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    by_page = granularity == "page";
+  }
+
+  std::shared_ptr<SnapshotData> a = Snapshot::Unwrap(info[0].As<Napi::Object>())->data;
+  std::shared_ptr<SnapshotData> b = Snapshot::Unwrap(info[1].As<Napi::Object>())->data;
+  if (!a || !b)
+  {
+    Napi::Error::New(env, "Snapshot is closed").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<unsigned long long> addresses;
+  std::vector<uint32_t> lengths;
+  diff_snapshot_data(*a, *b, by_page, [&](unsigned long long addr, size_t len)
+                     {
+    if (!addresses.empty() && addresses.back() + lengths.back() == addr && lengths.back() <= UINT32_MAX - len)
+    {
+      lengths.back() += len;
+      return;
+    }
+    addresses.push_back(addr);
+    lengths.push_back(len); });
+
+  Napi::BigUint64Array address_array = Napi::BigUint64Array::New(env, addresses.size());
+  Napi::Uint32Array length_array = Napi::Uint32Array::New(env, lengths.size());
+  if (!addresses.empty())
+  {
+    memcpy(address_array.Data(), addresses.data(), addresses.size() * sizeof(uint64_t));
+    memcpy(length_array.Data(), lengths.data(), lengths.size() * sizeof(uint32_t));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", address_array);
+  result.Set("lengths", length_array);
+  return result;
+}
+
+// watch(): a native thread re-reads a set of typed addresses at a fixed rate
+// and hands the entries that changed to a JS callback. Changes wait in a
+// pending set keyed by entry, and at most one call is queued on the thread-
+// safe function at a time, so when JS falls behind, several ticks arrive as
+// one batch holding the latest value of each entry.
+struct WatchEntry
+{
+  unsigned long long address;
+  ValueType type;
+};
+
+struct WatchChange
+{
+  size_t index;
+  WatchEntry entry;
+  unsigned char value[8];
+  unsigned char previous[8];
+  bool has_previous;
+};
+
+struct WatchState
+{
+  std::shared_ptr<ProcessMemory> proc;
+  int export_id;
+  std::chrono::nanoseconds period;
+  Napi::ThreadSafeFunction on_change;
+  std::thread thread;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<WatchEntry> entries;
+  unsigned long long generation = 0;
+  bool paused = false;
+  bool stopping = false;
+  std::vector<WatchChange> pending;
+  std::vector<long> pending_slot;
+  bool call_queued = false;
+
+  std::atomic<unsigned long long> ticks{0};
+  std::atomic<unsigned long long> missed{0};
+  std::atomic<unsigned long long> read_errors{0};
+  std::atomic<unsigned long long> deliveries{0};
+  std::atomic<unsigned long long> changes{0};
+  std::atomic<unsigned long long> total_lateness_ns{0};
+  std::atomic<unsigned long long> max_lateness_ns{0};
+  std::atomic<bool> exited{false};
+};
+
+bool get_watch_entries(const Napi::Value &value, std::vector<WatchEntry> &entries)
+{
+  if (!value.IsArray())
+  {
+    return false;
+  }
+  Napi::Array array = value.As<Napi::Array>();
+  entries.resize(array.Length());
+  for (uint32_t i = 0; i < array.Length(); ++i)
+  {
+    Napi::Value item = array.Get(i);
+    if (!item.IsObject())
+    {
+      return false;
+    }
+    Napi::Object object = item.As<Napi::Object>();
+    Napi::Value type = object.Get("type");
+    if (!get_address(object.Get("address"), entries[i].address) || !type.IsString() ||
+        !parse_value_type(type.As<Napi::String>(), entries[i].type))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs on the JS thread: takes the pending changes and calls back with
+// [{ index, address, value, previous }], previous being null the first time
+// an entry is seen.
+void deliver_watch_changes(std::shared_ptr<WatchState> state, Napi::Env env, Napi::Function callback)
+{
+  std::vector<WatchChange> changes;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    changes.swap(state->pending);
+    for (const WatchChange &change : changes)
+    {
+      state->pending_slot[change.index] = -1;
+    }
+    state->call_queued = false;
+  }
+  if (env == nullptr || callback == nullptr || changes.empty())
+  {
+    return;
+  }
+
+  Napi::Array array = Napi::Array::New(env, changes.size());
+  for (size_t i = 0; i < changes.size(); ++i)
+  {
+    const WatchChange &change = changes[i];
+    Napi::Object item = Napi::Object::New(env);
+    item.Set("index", Napi::Number::New(env, change.index));
+    item.Set("address", Napi::BigInt::New(env, (uint64_t)change.entry.address));
+    item.Set("value", value_to_js(env, change.entry.type, change.value));
+    item.Set("previous", change.has_previous ? value_to_js(env, change.entry.type, change.previous) : env.Null());
+    array.Set(i, item);
+  }
+  state->deliveries++;
+  callback.Call({array});
+}
+
+void run_watcher(std::shared_ptr<WatchState> state)
+{
+  ExportScope scope(state->export_id);
+  std::vector<WatchEntry> entries;
+  unsigned long long generation = ~0ULL;
+  std::vector<unsigned char> current;
+  std::vector<unsigned char> last;
+  std::vector<unsigned char> seen;
+  std::vector<MemoryRange> ranges;
+  std::vector<unsigned char> ok;
+  auto deadline = std::chrono::steady_clock::now();
+  // The default 50us timer slack would be most of the jitter at high rates.
+  prctl(PR_SET_TIMERSLACK, 1);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (!state->stopping)
+  {
+    if (state->paused)
+    {
+      state->wake.wait(lock, [&]
+                       { return !state->paused || state->stopping; });
+      deadline = std::chrono::steady_clock::now();
+      continue;
+    }
+    if (state->wake.wait_until(lock, deadline, [&]
+                               { return state->stopping || state->paused; }))
+    {
+      continue;
+    }
+
+    auto woke = std::chrono::steady_clock::now();
+    unsigned long long late = std::chrono::duration_cast<std::chrono::nanoseconds>(woke - deadline).count();
+    state->total_lateness_ns += late;
+    if (late > state->max_lateness_ns)
+    {
+      state->max_lateness_ns = late;
+    }
+
+    if (generation != state->generation)
+    {
+      generation = state->generation;
+      entries = state->entries;
+      current.assign(entries.size() * 8, 0);
+      last.assign(entries.size() * 8, 0);
+      seen.assign(entries.size(), 0);
+      ok.assign(entries.size(), 0);
+      ranges.resize(entries.size());
+      for (size_t i = 0; i < entries.size(); ++i)
+      {
+        ranges[i] = {entries[i].address, current.data() + i * 8, value_type_size(entries[i].type)};
+      }
+    }
+    lock.unlock();
+
+    read_ranges(*state->proc, ranges.data(), ranges.size(), ok.data());
+    state->ticks++;
+
+    lock.lock();
+    if (state->proc->exited)
+    {
+      state->exited = true;
+      break;
+    }
+    // A retarget while reading makes these values stale.
+    if (generation == state->generation)
+    {
+      for (size_t i = 0; i < entries.size(); ++i)
+      {
+        size_t size = ranges[i].len;
+        if (!ok[i])
+        {
+          state->read_errors++;
+          continue;
+        }
+        if (seen[i] && memcmp(current.data() + i * 8, last.data() + i * 8, size) == 0)
+        {
+          continue;
+        }
+
+        long slot = state->pending_slot[i];
+        if (slot < 0)
+        {
+          WatchChange change;
+          change.index = i;
+          change.entry = entries[i];
+          change.has_previous = seen[i];
+          memcpy(change.previous, last.data() + i * 8, 8);
+          slot = state->pending.size();
+          state->pending.push_back(change);
+          state->pending_slot[i] = slot;
+        }
+        memcpy(state->pending[slot].value, current.data() + i * 8, 8);
+        memcpy(last.data() + i * 8, current.data() + i * 8, 8);
+        seen[i] = 1;
+        state->changes++;
+      }
+
+      if (!state->pending.empty() && !state->call_queued)
+      {
+        std::shared_ptr<WatchState> shared = state;
+        state->call_queued = state->on_change.NonBlockingCall([shared](Napi::Env env, Napi::Function callback)
+                                                             { deliver_watch_changes(shared, env, callback); }) == napi_ok;
+      }
+    }
+
+    // Ticks that could not start on time are skipped, not run late.
+    deadline += state->period;
+    auto now = std::chrono::steady_clock::now();
+    if (now > deadline)
+    {
+      unsigned long long behind = (now - deadline) / state->period + 1;
+      state->missed += behind;
+      deadline += state->period * behind;
+    }
+  }
+  lock.unlock();
+  state->on_change.Release();
+}
+
+class Watcher : public Napi::ObjectWrap<Watcher>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "Watcher",
+                       {InstanceMethod("pause", &Watcher::pause),
+                        InstanceMethod("resume", &Watcher::resume),
+                        InstanceMethod("retarget", &Watcher::retarget),
+                        InstanceMethod("stop", &Watcher::stop),
+                        InstanceMethod("stats", &Watcher::get_stats)});
+  }
+
+  Watcher(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Watcher>(info) {}
+
+  ~Watcher()
+  {
+    stop_thread();
+  }
+
+  void start(std::shared_ptr<WatchState> watch_state)
+  {
+    state = watch_state;
+    state->thread = std::thread(run_watcher, state);
+  }
+
+private:
+  void stop_thread()
+  {
+    if (!state)
+    {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->stopping = true;
+    }
+    state->wake.notify_all();
+    state->thread.join();
+    state.reset();
+  }
+
+  Napi::Value set_paused(const Napi::CallbackInfo &info, bool paused)
+  {
+    if (state)
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->paused = paused;
+    }
+    if (state)
+    {
+      state->wake.notify_all();
+    }
+    return info.Env().Null();
+  }
+
+  Napi::Value pause(const Napi::CallbackInfo &info)
+  {
+    return set_paused(info, true);
+  }
+
+  Napi::Value resume(const Napi::CallbackInfo &info)
+  {
+    return set_paused(info, false);
+  }
+
+  // retarget(descriptors) swaps in a new set of entries; the next tick
+  // reports all of them, with previous null.
+  Napi::Value retarget(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    std::vector<WatchEntry> entries;
+    if (info.Length() < 1 || !get_watch_entries(info[0], entries))
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (state)
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->entries = entries;
+      state->generation++;
+      state->pending.clear();
+      state->pending_slot.assign(entries.size(), -1);
+    }
+    return env.Null();
+  }
+
+  Napi::Value stop(const Napi::CallbackInfo &info)
+  {
+    stop_thread();
+    return info.Env().Null();
+  }
+
+  Napi::Value get_stats(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    if (!state)
+    {
+      return result;
+    }
+    unsigned long long ticks = state->ticks;
+    result.Set("ticks", Napi::Number::New(env, ticks));
+    result.Set("missedDeadlines", Napi::Number::New(env, state->missed));
+    result.Set("readErrors", Napi::Number::New(env, state->read_errors));
+    result.Set("changes", Napi::Number::New(env, state->changes));
+    result.Set("deliveries", Napi::Number::New(env, state->deliveries));
+    result.Set("averageLatenessUs", Napi::Number::New(env, ticks ? state->total_lateness_ns / 1000.0 / ticks : 0));
+    result.Set("maxLatenessUs", Napi::Number::New(env, state->max_lateness_ns / 1000.0));
+    result.Set("exited", Napi::Boolean::New(env, state->exited));
+    return result;
+  }
+
+  std::shared_ptr<WatchState> state;
+};
+
+// watch(pid, descriptors, hz, callback) samples [{ address, type }, ...] hz
+// times a second on a native thread and calls callback with the entries
+// that changed. Returns a Watcher with pause(), resume(), retarget(),
+// stop() and stats(); it keeps the event loop alive until stopped.
+Napi::Value watch(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 4)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<WatchEntry> entries;
+  if (!get_watch_entries(info[1], entries) || !info[2].IsNumber() || !info[3].IsFunction())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  double hz = info[2].As<Napi::Number>().DoubleValue();
+  if (!(hz > 0 && hz <= 100000))
+  {
+    Napi::RangeError::New(env, "hz must be between 0 and 100000").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  std::shared_ptr<WatchState> state = std::make_shared<WatchState>();
+  state->proc = proc;
+  state->period = std::chrono::nanoseconds((long long)(1e9 / hz));
+  state->export_id = current_export;
+  state->entries = entries;
+  state->pending_slot.assign(entries.size(), -1);
+  state->on_change = Napi::ThreadSafeFunction::New(env, info[3].As<Napi::Function>(), "watch", 0, 1);
+
+  Napi::Object handle = env.GetInstanceData<AddonData>()->watcher.New({});
+  Watcher::Unwrap(handle)->start(state);
+  return handle;
+}
+
+// start_sampler(): a native thread samples a set of typed addresses at a
+// fixed rate into a single-producer/single-consumer ring the caller placed
+// in a SharedArrayBuffer. Nothing crosses into JS per sample; consumers on
+// any thread poll the header with Atomics. The header is SAMPLER_HEADER_WORDS
+// 32-bit words:
+//   0 version          4 write count (sampler)    8 read errors
+//   1 header bytes     5 read count (consumer)    9 entry count
+//   2 record bytes     6 dropped (ring full)     10 running
+//   3 capacity         7 missed deadlines
+// followed by capacity records of: a u64 CLOCK_MONOTONIC timestamp in ns (the
+// clock behind process.hrtime.bigint()), ceil(entries / 64) u64 words of
+// valid bits, then an 8 byte slot per entry holding the value in its low
+// bytes. The counts only grow and wrap at 2^32; capacity is a power of two,
+// so record i lives at slot i % capacity.
+enum SamplerHeader
+{
+  SAMPLER_VERSION,
+  SAMPLER_HEADER_BYTES,
+  SAMPLER_RECORD_BYTES,
+  SAMPLER_CAPACITY,
+  SAMPLER_WRITE,
+  SAMPLER_READ,
+  SAMPLER_DROPPED,
+  SAMPLER_MISSED,
+  SAMPLER_READ_ERRORS,
+  SAMPLER_ENTRIES,
+  SAMPLER_RUNNING,
+  SAMPLER_HEADER_WORDS = 16
+};
+
+struct SamplerState
+{
+  std::shared_ptr<ProcessMemory> proc;
+  int export_id;
+  std::chrono::nanoseconds period;
+  std::vector<WatchEntry> entries;
+  uint32_t *header;
+  unsigned char *records;
+  size_t record_size;
+  size_t valid_words;
+  uint32_t capacity;
+  std::thread thread;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool paused = false;
+  bool stopping = false;
+
+  std::atomic<unsigned long long> ticks{0};
+  std::atomic<unsigned long long> written{0};
+  std::atomic<unsigned long long> dropped{0};
+  std::atomic<unsigned long long> missed{0};
+  std::atomic<unsigned long long> read_errors{0};
+  std::atomic<unsigned long long> total_lateness_ns{0};
+  std::atomic<unsigned long long> max_lateness_ns{0};
+  std::atomic<bool> exited{false};
+};
+
+size_t sampler_record_size(size_t entries)
+{
+  return 8 + (entries + 63) / 64 * 8 + entries * 8;
+}
+
+void run_sampler(std::shared_ptr<SamplerState> state)
+{
+  ExportScope scope(state->export_id);
+  const std::vector<WatchEntry> &entries = state->entries;
+  std::vector<MemoryRange> ranges(entries.size());
+  std::vector<unsigned char> ok(entries.size());
+  uint32_t *header = state->header;
+  uint32_t write = 0;
+  uint32_t dropped = 0;
+  uint32_t missed = 0;
+  uint32_t read_errors = 0;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    ranges[i] = {entries[i].address, nullptr, value_type_size(entries[i].type)};
+  }
+  auto deadline = std::chrono::steady_clock::now();
+  prctl(PR_SET_TIMERSLACK, 1);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (!state->stopping)
+  {
+    if (state->paused)
+    {
+      state->wake.wait(lock, [&]
+                       { return !state->paused || state->stopping; });
+      deadline = std::chrono::steady_clock::now();
+      continue;
+    }
+    if (state->wake.wait_until(lock, deadline, [&]
+                               { return state->stopping || state->paused; }))
+    {
+      continue;
+    }
+    lock.unlock();
+
+    auto woke = std::chrono::steady_clock::now();
+    unsigned long long late = std::chrono::duration_cast<std::chrono::nanoseconds>(woke - deadline).count();
+    state->total_lateness_ns += late;
+    if (late > state->max_lateness_ns)
+    {
+      state->max_lateness_ns = late;
+    }
+    state->ticks++;
+
+    // The consumer publishes its read count with Atomics.store; acquire
+    // pairs with it so the slot it just finished is safe to reuse.
+    uint32_t read = __atomic_load_n(&header[SAMPLER_READ], __ATOMIC_ACQUIRE);
+    if (write - read >= state->capacity)
+    {
+      state->dropped++;
+      __atomic_store_n(&header[SAMPLER_DROPPED], ++dropped, __ATOMIC_RELEASE);
+    }
+    else
+    {
+      unsigned char *record = state->records + (size_t)(write & (state->capacity - 1)) * state->record_size;
+      uint64_t *valid = reinterpret_cast<uint64_t *>(record + 8);
+      unsigned char *slots = record + 8 + state->valid_words * 8;
+      for (size_t i = 0; i < ranges.size(); ++i)
+      {
+        ranges[i].buf = slots + i * 8;
+      }
+
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      uint64_t timestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+      memcpy(record, &timestamp, 8);
+      read_ranges(*state->proc, ranges.data(), ranges.size(), ok.data());
+      if (state->proc->exited)
+      {
+        state->exited = true;
+        break;
+      }
+
+      std::fill(valid, valid + state->valid_words, 0);
+      for (size_t i = 0; i < ranges.size(); ++i)
+      {
+        if (ok[i])
+        {
+          valid[i / 64] |= 1ULL << (i % 64);
+          std::fill(slots + i * 8 + ranges[i].len, slots + i * 8 + 8, 0);
+        }
+        else
+        {
+          std::fill(slots + i * 8, slots + i * 8 + 8, 0);
+          state->read_errors++;
+          ++read_errors;
+        }
+      }
+      __atomic_store_n(&header[SAMPLER_READ_ERRORS], read_errors, __ATOMIC_RELAXED);
+      // Publishing the write count releases the record to the consumer.
+      __atomic_store_n(&header[SAMPLER_WRITE], ++write, __ATOMIC_RELEASE);
+      state->written++;
+    }
+
+    deadline += state->period;
+    auto now = std::chrono::steady_clock::now();
+    if (now > deadline)
+    {
+      unsigned long long behind = (now - deadline) / state->period + 1;
+      state->missed += behind;
+      missed += behind;
+      __atomic_store_n(&header[SAMPLER_MISSED], missed, __ATOMIC_RELEASE);
+      deadline += state->period * behind;
+    }
+    lock.lock();
+  }
+  if (lock.owns_lock())
+  {
+    lock.unlock();
+  }
+  __atomic_store_n(&header[SAMPLER_RUNNING], 0, __ATOMIC_RELEASE);
+}
+
+class Sampler : public Napi::ObjectWrap<Sampler>
+{
+public:
+  static Napi::Function Define(Napi::Env env)
+  {
+    return DefineClass(env, "Sampler",
+                       {InstanceMethod("pause", &Sampler::pause),
+                        InstanceMethod("resume", &Sampler::resume),
+                        InstanceMethod("stop", &Sampler::stop),
+                        InstanceMethod("stats", &Sampler::get_stats)});
+  }
+
+  Sampler(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Sampler>(info) {}
+
+  ~Sampler()
+  {
+    stop_thread();
+  }
+
+  // The reference keeps the ring's backing store alive for as long as the
+  // thread writes into it.
+  void start(std::shared_ptr<SamplerState> sampler_state, Napi::Object ring)
+  {
+    state = sampler_state;
+    buffer = Napi::Persistent(ring);
+    state->thread = std::thread(run_sampler, state);
+  }
+
+private:
+  void stop_thread()
+  {
+    if (!state)
+    {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->stopping = true;
+    }
+    state->wake.notify_all();
+    state->thread.join();
+  }
+
+  Napi::Value set_paused(const Napi::CallbackInfo &info, bool paused)
+  {
+    if (state)
+    {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->paused = paused;
+      }
+      state->wake.notify_all();
+    }
+    return info.Env().Null();
+  }
+
+  Napi::Value pause(const Napi::CallbackInfo &info)
+  {
+    return set_paused(info, true);
+  }
+
+  Napi::Value resume(const Napi::CallbackInfo &info)
+  {
+    return set_paused(info, false);
+  }
+
+  Napi::Value stop(const Napi::CallbackInfo &info)
+  {
+    stop_thread();
+    state.reset();
+    buffer.Reset();
+    return info.Env().Null();
+  }
+
+  Napi::Value get_stats(const Napi::CallbackInfo &info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    if (!state)
+    {
+      return result;
+    }
+    unsigned long long ticks = state->ticks;
+    result.Set("ticks", Napi::Number::New(env, ticks));
+    result.Set("written", Napi::Number::New(env, state->written));
+    result.Set("dropped", Napi::Number::New(env, state->dropped));
+    result.Set("missedDeadlines", Napi::Number::New(env, state->missed));
+    result.Set("readErrors", Napi::Number::New(env, state->read_errors));
+    result.Set("averageLatenessUs", Napi::Number::New(env, ticks ? state->total_lateness_ns / 1000.0 / ticks : 0));
+    result.Set("maxLatenessUs", Napi::Number::New(env, state->max_lateness_ns / 1000.0));
+    result.Set("exited", Napi::Boolean::New(env, state->exited));
+    return result;
+  }
+
+  std::shared_ptr<SamplerState> state;
+  Napi::ObjectReference buffer;
+};
+
+// start_sampler(pid, descriptors, hz, ring) samples [{ address, type }, ...]
+// hz times a second into ring, a TypedArray over a SharedArrayBuffer laid out
+// as described above; the header is (re)initialised here and the capacity
+// is the largest power of two that fits. Returns a Sampler with pause(),
+// resume(), stop() and stats(); sampling also stops if it is collected.
+Napi::Value start_sampler(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 4)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<WatchEntry> entries;
+  if (!get_watch_entries(info[1], entries) || entries.empty() || !info[2].IsNumber() || !info[3].IsTypedArray())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  double hz = info[2].As<Napi::Number>().DoubleValue();
+  if (!(hz > 0 && hz <= 100000))
+  {
+    Napi::RangeError::New(env, "hz must be between 0 and 100000").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // The sampler thread writes into the ring for as long as it runs. A plain
+  // ArrayBuffer can be detached (transferred) under it, which frees the
+  // memory; a SharedArrayBuffer cannot.
+  Napi::Value shared = env.Global().Get("SharedArrayBuffer");
+  Napi::Value backing = info[3].As<Napi::Object>().Get("buffer");
+  if (!shared.IsFunction() || !backing.IsObject() || !backing.As<Napi::Object>().InstanceOf(shared.As<Napi::Function>()))
+  {
+    Napi::TypeError::New(env, "Ring must be backed by a SharedArrayBuffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Napi::ArrayBuffer refuses SharedArrayBuffers, but the typed array info
+  // hands back the data pointer of either.
+  napi_typedarray_type array_type;
+  size_t length;
+  void *data;
+  size_t offset;
+  napi_status status = napi_get_typedarray_info(env, info[3], &array_type, &length, &data, nullptr, &offset);
+  if (status != napi_ok)
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t bytes = info[3].As<Napi::TypedArray>().ByteLength();
+  size_t record_size = sampler_record_size(entries.size());
+  if (((uintptr_t)data & 7) != 0)
+  {
+    Napi::RangeError::New(env, "Ring must start on an 8 byte boundary").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (bytes < SAMPLER_HEADER_WORDS * 4 + record_size)
+  {
+    Napi::RangeError::New(env, "Ring is too small for a single record").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+
+  size_t fits = std::min((bytes - SAMPLER_HEADER_WORDS * 4) / record_size, (size_t)1 << 31);
+  uint32_t capacity = 1;
+  while ((size_t)capacity * 2 <= fits)
+  {
+    capacity *= 2;
+  }
+
+  std::shared_ptr<SamplerState> state = std::make_shared<SamplerState>();
+  state->proc = proc;
+  state->period = std::chrono::nanoseconds((long long)(1e9 / hz));
+  state->export_id = current_export;
+  state->entries = entries;
+  state->header = static_cast<uint32_t *>(data);
+  state->records = static_cast<unsigned char *>(data) + SAMPLER_HEADER_WORDS * 4;
+  state->record_size = record_size;
+  state->valid_words = (entries.size() + 63) / 64;
+  state->capacity = capacity;
+
+  uint32_t *header = state->header;
+  for (int i = 0; i < SAMPLER_HEADER_WORDS; ++i)
+  {
+    __atomic_store_n(&header[i], 0, __ATOMIC_RELAXED);
+  }
+  header[SAMPLER_VERSION] = 1;
+  header[SAMPLER_HEADER_BYTES] = SAMPLER_HEADER_WORDS * 4;
+  header[SAMPLER_RECORD_BYTES] = record_size;
+  header[SAMPLER_CAPACITY] = capacity;
+  header[SAMPLER_ENTRIES] = entries.size();
+  __atomic_store_n(&header[SAMPLER_RUNNING], 1, __ATOMIC_RELEASE);
+
+  Napi::Object handle = env.GetInstanceData<AddonData>()->sampler.New({});
+  Sampler::Unwrap(handle)->start(state, info[3].As<Napi::Object>());
+  return handle;
+}
+
+// read_batch_multi(pids, descriptors, options) reads the same kind of
+// fields from many processes in one call: the per-process vectored reads
+// run concurrently on the worker pool and the values land in one
+// Float64Array, row-major, one row per pid and one column per descriptor.
+// descriptors is one [{ address, type }, ...] list shared by every pid, or
+// one list per pid (same length) when the addresses differ. Fields that could
+// not be read, and rows of processes that could not be opened, are NaN.
+// options.threads caps the threads used.
+Napi::Value read_batch_multi(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!info[0].IsArray() || !info[1].IsArray())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array pids = info[0].As<Napi::Array>();
+  Napi::Array descriptors = info[1].As<Napi::Array>();
+  size_t rows = pids.Length();
+  bool per_pid = descriptors.Length() > 0 && descriptors.Get((uint32_t)0).IsArray();
+  std::vector<std::vector<WatchEntry>> layouts(per_pid ? rows : 1);
+  if (per_pid && descriptors.Length() != rows)
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  for (size_t i = 0; i < layouts.size(); ++i)
+  {
+    if (!get_watch_entries(per_pid ? descriptors.Get(i) : (Napi::Value)descriptors, layouts[i]) ||
+        layouts[i].size() != layouts[0].size())
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  size_t columns = layouts[0].size();
+
+  size_t threads = 0;
+  if (info.Length() > 2 && info[2].IsObject() && info[2].As<Napi::Object>().Has("threads"))
+  {
+    threads = info[2].As<Napi::Object>().Get("threads").ToNumber().Uint32Value();
+  }
+
+  // Processes are opened here, on the JS thread; one that cannot be opened
+  // leaves its row NaN instead of failing the whole call.
+  std::vector<std::shared_ptr<ProcessMemory>> procs(rows);
+  for (size_t row = 0; row < rows; ++row)
+  {
+    Napi::Value pid = pids.Get(row);
+    std::string error;
+    if (pid.IsNumber())
+    {
+      procs[row] = process_for_pid(pid.As<Napi::Number>().Int32Value(), error);
+    }
+    else if (is_process_handle(pid))
+    {
+      procs[row] = ProcessHandle::Unwrap(pid.As<Napi::Object>())->memory;
+    }
+    else
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  Napi::Float64Array matrix = Napi::Float64Array::New(env, rows * columns);
+  double *out = matrix.Data();
+  WorkerPool &pool = WorkerPool::shared();
+  pool.parallel_for(rows, threads ? threads : pool.size() + 1, [&](size_t row)
+                    {
+    double *values = out + row * columns;
+    std::shared_ptr<ProcessMemory> &proc = procs[row];
+    if (!proc || proc->exited)
+    {
+      std::fill(values, values + columns, NAN);
+      return;
+    }
+
+    const std::vector<WatchEntry> &layout = layouts[per_pid ? row : 0];
+    thread_local std::vector<unsigned char> raw;
+    thread_local std::vector<MemoryRange> ranges;
+    thread_local std::vector<unsigned char> ok;
+    raw.resize(columns * 8);
+    ranges.resize(columns);
+    ok.resize(columns);
+    for (size_t column = 0; column < columns; ++column)
+    {
+      ranges[column] = {layout[column].address, raw.data() + column * 8, value_type_size(layout[column].type)};
+    }
+    read_ranges(*proc, ranges.data(), columns, ok.data());
+    for (size_t column = 0; column < columns; ++column)
+    {
+      values[column] = ok[column] ? value_to_number(layout[column].type, raw.data() + column * 8) : NAN;
+    } });
+  return matrix;
+}
+
+// pin_worker_pool(cpus) pins the native worker pool used by scans and
+// read_batch_multi, thread i to cpus[i % cpus.length]; an empty array
+// unpins it. Returns the pool size.
+Napi::Value pin_worker_pool(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!info[0].IsArray())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array array = info[0].As<Napi::Array>();
+  std::vector<int> cpus(array.Length());
+  for (uint32_t i = 0; i < array.Length(); ++i)
+  {
+    Napi::Value cpu = array.Get(i);
+    if (!cpu.IsNumber() || cpu.As<Napi::Number>().Int32Value() < 0 || cpu.As<Napi::Number>().Int32Value() >= CPU_SETSIZE)
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    cpus[i] = cpu.As<Napi::Number>().Int32Value();
+  }
+
+  WorkerPool &pool = WorkerPool::shared();
+  int error = pool.pin(cpus);
+  if (error)
+  {
+    Napi::Error::New(env, std::string("Failed to pin the worker pool: ") + strerror(error)).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Number::New(env, pool.size());
+}
+
+// pointer_scan(): finds chains of pointers from module-relative static
+// addresses to a target, as resolve_pointer_chain would follow them. Every
+// aligned 64-bit value in the scanned regions that points into mapped
+// memory goes into a reverse index of (value, address) pairs, kept in a
+// SnapshotLayer (anonymous or an unlinked file in cacheDir) and sorted by
+// value with a parallel sample sort. The search walks back from the target
+// through pointers at most maxOffset below each address, up to maxDepth
+// levels. It stops at pointers stored inside a module's mappings and prunes
+// cycles; each thread works through its share of the first levels.
+//
+// Results go to a binary file so that runs can be intersected:
+//   header   "RMPTRS1\0", u32 depth capacity, u32 module count,
+//            u64 record count, u64 names size
+//   names    module paths, NUL-terminated, sorted by file name then path
+//   records  i32 module, u32 depth, u64 offset from the module base,
+//            u32 offsets[depth capacity]
+// Records are sorted by module, base offset, then offsets.
+const uint32_t pointer_scan_max_depth = 16;
+const char pointer_scan_magic[8] = {'R', 'M', 'P', 'T', 'R', 'S', '1', 0};
+
+struct PointerPair
+{
+  uint64_t value;
+  uint64_t address;
+};
+
+struct PointerPath
+{
+  int32_t module;
+  uint32_t depth;
+  uint64_t base_offset;
+  uint32_t offsets[pointer_scan_max_depth];
+};
+
+struct PointerScanFileHeader
+{
+  char magic[8];
+  uint32_t depth_capacity;
+  uint32_t module_count;
+  uint64_t count;
+  uint64_t names_size;
+};
+
+struct PointerScanOptions
+{
+  ScanOptions scan;
+  uint32_t max_depth = 5;
+  uint64_t max_offset = 0x1000;
+  std::vector<std::string> modules;
+  std::string cache_dir;
+  std::string output;
+
+  PointerScanOptions()
+  {
+    scan.filter.perms = "rw";
+    scan.alignment = 8;
+    scan.max_results = 1000000;
+  }
+};
+
+struct PointerScanStats
+{
+  unsigned long long bytes_scanned = 0;
+  unsigned long long bytes_skipped = 0;
+  size_t pointers = 0;
+  size_t paths = 0;
+  bool truncated = false;
+  double index_seconds = 0;
+  double search_seconds = 0;
+};
+
+bool get_pointer_scan_options(const Napi::Value &value, PointerScanOptions &options)
+{
+  if (!value.IsObject() || !value.As<Napi::Object>().Get("output").IsString() || !get_scan_options(value, options.scan))
+  {
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  options.output = object.Get("output").As<Napi::String>().Utf8Value();
+  options.scan.alignment = std::max<unsigned long long>(options.scan.alignment, 1);
+  if (object.Has("maxDepth"))
+  {
+    options.max_depth = object.Get("maxDepth").ToNumber().Uint32Value();
+  }
+  if (object.Has("maxOffset"))
+  {
+    options.max_offset = object.Get("maxOffset").ToNumber().Uint32Value();
+  }
+  if (object.Has("cacheDir"))
+  {
+    if (!object.Get("cacheDir").IsString())
+    {
+      return false;
+    }
+    options.cache_dir = object.Get("cacheDir").As<Napi::String>().Utf8Value();
+  }
+  if (object.Has("modules"))
+  {
+    if (!object.Get("modules").IsArray())
+    {
+      return false;
+    }
+    Napi::Array modules = object.Get("modules").As<Napi::Array>();
+    for (uint32_t i = 0; i < modules.Length(); ++i)
+    {
+      if (!modules.Get(i).IsString())
+      {
+        return false;
+      }
+      options.modules.push_back(modules.Get(i).As<Napi::String>().Utf8Value());
+    }
+  }
+  return options.max_depth >= 1 && options.max_depth <= pointer_scan_max_depth;
+}
+
+// Sorts pairs by value: splitters sampled from the data cut it into
+// buckets, each thread scatters its chunk into `spare`, then the buckets
+// are sorted in parallel. The sorted pairs end up in `spare`.
+void sort_pointer_pairs(PointerPair *pairs, size_t count, PointerPair *spare, size_t threads)
+{
+  auto by_value = [](const PointerPair &a, const PointerPair &b)
+  { return a.value < b.value; };
+  if (count < (1 << 20) || threads < 2)
+  {
+    std::copy(pairs, pairs + count, spare);
+    std::sort(spare, spare + count, by_value);
+    return;
+  }
+
+  const size_t buckets = 1024;
+  std::vector<uint64_t> samples;
+  for (size_t i = 0; i < buckets * 16; ++i)
+  {
+    samples.push_back(pairs[i * (count / (buckets * 16))].value);
+  }
+  std::sort(samples.begin(), samples.end());
+  std::vector<uint64_t> splitters;
+  for (size_t i = 1; i < buckets; ++i)
+  {
+    splitters.push_back(samples[i * 16]);
+  }
+
+  WorkerPool &pool = WorkerPool::shared();
+  size_t chunks = pool.size() + 1;
+  size_t chunk_size = (count + chunks - 1) / chunks;
+  std::vector<size_t> counts(chunks * buckets, 0);
+  auto bucket_of = [&](uint64_t value)
+  { return (size_t)(std::upper_bound(splitters.begin(), splitters.end(), value) - splitters.begin()); };
+  pool.parallel_for(chunks, threads, [&](size_t chunk)
+                    {
+    for (size_t i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); ++i)
+    {
+      counts[chunk * buckets + bucket_of(pairs[i].value)]++;
+    } });
+
+  // Bucket b of chunk c starts after every earlier bucket, then after bucket
+  // b of every earlier chunk.
+  std::vector<size_t> starts(chunks * buckets);
+  std::vector<size_t> bucket_starts(buckets + 1, 0);
+  size_t at = 0;
+  for (size_t b = 0; b < buckets; ++b)
+  {
+    bucket_starts[b] = at;
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      starts[c * buckets + b] = at;
+      at += counts[c * buckets + b];
+    }
+  }
+  bucket_starts[buckets] = at;
+
+  pool.parallel_for(chunks, threads, [&](size_t chunk)
+                    {
+    size_t *next = &starts[chunk * buckets];
+    for (size_t i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); ++i)
+    {
+      spare[next[bucket_of(pairs[i].value)]++] = pairs[i];
+    } });
+  pool.parallel_for(buckets, threads, [&](size_t b)
+                    { std::sort(spare + bucket_starts[b], spare + bucket_starts[b + 1], by_value); });
+}
+
+// Reads the scanned regions and builds the sorted reverse index in `sorted`.
+bool build_pointer_index(ProcessMemory &proc, const ProcessMaps &maps, const PointerScanOptions &options,
+                         SnapshotLayer &sorted, PointerScanStats &stats, const std::atomic<bool> *cancelled,
+                         std::string &error)
+{
+  const ScanOptions &scan = options.scan;
+  std::vector<ScanBlock> blocks = plan_scan(maps, scan, 0);
+  PageSkip skip(proc, maps, scan);
+  size_t capacity = 0;
+  for (const ScanBlock &block : blocks)
+  {
+    capacity += block.len / scan.alignment + 1;
+  }
+  SnapshotLayer unsorted;
+  if (!unsorted.map(capacity * sizeof(PointerPair), options.cache_dir, error))
+  {
+    return false;
+  }
+  PointerPair *pairs = reinterpret_cast<PointerPair *>(unsorted.data);
+  unsigned long long low = maps.regions.empty() ? 0 : maps.regions.front().start;
+  unsigned long long high = maps.regions.empty() ? 0 : maps.regions.back().end;
+  std::atomic<size_t> count(0);
+  std::atomic<unsigned long long> bytes(0);
+  size_t threads = scan.threads ? scan.threads : WorkerPool::shared().size() + 1;
+
+  WorkerPool::shared().parallel_for(blocks.size(), threads, [&](size_t i)
+                                    {
+    const ScanBlock &block = blocks[i];
+    if ((cancelled && *cancelled) || proc.exited)
+    {
+      return;
+    }
+    thread_local std::vector<unsigned char> buf;
+    thread_local std::vector<PointerPair> found;
+    found.clear();
+    bytes += read_block(proc, block, buf, skip, [&](unsigned long long addr, const unsigned char *data, size_t len)
+                        {
+      unsigned long long first = (addr + scan.alignment - 1) / scan.alignment * scan.alignment;
+      for (size_t offset = first - addr; offset + 8 <= len && addr + offset < block.start + block.len; offset += scan.alignment)
+      {
+        uint64_t value;
+        memcpy(&value, data + offset, 8);
+        if (value >= low && value < high && maps.find(value))
+        {
+          found.push_back({value, addr + offset});
+        }
+      } });
+    size_t at = count.fetch_add(found.size());
+    std::copy(found.begin(), found.end(), pairs + at); });
+
+  stats.bytes_scanned = bytes;
+  stats.bytes_skipped = skip.skipped;
+  stats.pointers = count;
+  if (proc.exited)
+  {
+    error = "Process " + std::to_string(proc.pid) + " has exited";
+    return false;
+  }
+  if (!sorted.map(std::max<size_t>(count, 1) * sizeof(PointerPair), options.cache_dir, error))
+  {
+    return false;
+  }
+  sort_pointer_pairs(pairs, count, reinterpret_cast<PointerPair *>(sorted.data), threads);
+  return true;
+}
+
+// The search state shared by the threads walking back from the target.
+struct PointerSearch
+{
+  const ProcessMaps &maps;
+  const PointerPair *pairs;
+  size_t count;
+  uint32_t max_depth;
+  uint64_t max_offset;
+  size_t max_results;
+  const std::atomic<bool> *cancelled;
+  // Per region of maps: the index into `modules`, or -1 if pointers stored
+  // there are not static.
+  std::vector<int32_t> region_module;
+  std::vector<unsigned long long> region_base;
+  std::vector<std::string> modules;
+  std::atomic<size_t> results{0};
+  std::atomic<bool> truncated{false};
+
+  PointerSearch(const ProcessMaps &maps, const PointerPair *pairs, size_t count, const PointerScanOptions &options,
+                const std::atomic<bool> *cancelled)
+      : maps(maps), pairs(pairs), count(count), max_depth(options.max_depth), max_offset(options.max_offset),
+        max_results(options.scan.max_results), cancelled(cancelled)
+  {
+    // Modules are told apart by full path; two files with the same name
+    // have their own bases.
+    std::map<std::pair<std::string, std::string>, int32_t> names;
+    for (size_t i = 0; i < maps.regions.size(); ++i)
+    {
+      // A module's .bss is usually an anonymous mapping right after its
+      // last file-backed one; its globals are as static as .data's.
+      const MemoryRegion &region = maps.regions[i].path.empty() && i > 0 && maps.regions[i - 1].end == maps.regions[i].start &&
+                                           !maps.regions[i - 1].path.empty()
+                                       ? maps.regions[i - 1]
+                                       : maps.regions[i];
+      bool allowed = options.modules.empty() ||
+                     std::find(options.modules.begin(), options.modules.end(), path_basename(region.path)) != options.modules.end() ||
+                     std::find(options.modules.begin(), options.modules.end(), region.path) != options.modules.end();
+      if (region.path.empty() || region.path[0] != '/' || !allowed)
+      {
+        region_module.push_back(-1);
+        region_base.push_back(0);
+        continue;
+      }
+      names.emplace(std::make_pair(path_basename(region.path), region.path), 0);
+      region_module.push_back(0);
+      region_base.push_back(maps.module_bases.at(region.path));
+    }
+    // Module indices follow name order, so files from different runs sort
+    // their records the same way.
+    for (auto &entry : names)
+    {
+      entry.second = modules.size();
+      modules.push_back(entry.first.second);
+    }
+    for (size_t i = 0; i < maps.regions.size(); ++i)
+    {
+      if (region_module[i] >= 0)
+      {
+        const std::string &path = maps.regions[i].path.empty() ? maps.regions[i - 1].path : maps.regions[i].path;
+        region_module[i] = names[std::make_pair(path_basename(path), path)];
+      }
+    }
+  }
+
+  // A node of the search: an address the chain has to reach, and the
+  // offsets from there to the target.
+  struct Node
+  {
+    uint64_t address;
+    uint32_t depth;
+    uint32_t offsets[pointer_scan_max_depth];
+    uint64_t trail[pointer_scan_max_depth];
+  };
+
+  bool stopped() const
+  {
+    return truncated || (cancelled && *cancelled);
+  }
+
+  // Calls visit(child) for every pointer reaching node within max_offset,
+  // after emitting the ones stored at static addresses.
+  template <typename Visit>
+  void expand(const Node &node, std::vector<PointerPath> &out, Visit visit)
+  {
+    uint64_t low = node.address > max_offset ? node.address - max_offset : 0;
+    const PointerPair *it = std::lower_bound(pairs, pairs + count, low, [](const PointerPair &pair, uint64_t value)
+                                             { return pair.value < value; });
+    for (; it != pairs + count && it->value <= node.address && !stopped(); ++it)
+    {
+      uint64_t at = it->address;
+      bool cycle = at == node.address;
+      for (uint32_t k = 0; k < node.depth && !cycle; ++k)
+      {
+        cycle = node.trail[k] == at;
+      }
+      if (cycle)
+      {
+        continue;
+      }
+
+      Node child;
+      child.address = at;
+      child.depth = node.depth + 1;
+      child.offsets[0] = node.address - it->value;
+      std::copy(node.offsets, node.offsets + node.depth, child.offsets + 1);
+      child.trail[0] = node.address;
+      std::copy(node.trail, node.trail + node.depth, child.trail + 1);
+
+      const MemoryRegion *region = maps.find(at);
+      int32_t module = region ? region_module[region - maps.regions.data()] : -1;
+      if (module >= 0)
+      {
+        if (results++ >= max_results)
+        {
+          truncated = true;
+          return;
+        }
+        PointerPath path = {};
+        path.module = module;
+        path.depth = child.depth;
+        path.base_offset = at - region_base[region - maps.regions.data()];
+        std::copy(child.offsets, child.offsets + child.depth, path.offsets);
+        out.push_back(path);
+      }
+      else if (child.depth < max_depth)
+      {
+        visit(child);
+      }
+    }
+  }
+
+  void walk(const Node &node, std::vector<PointerPath> &out)
+  {
+    expand(node, out, [&](const Node &child)
+           { walk(child, out); });
+  }
+};
+
+bool path_less(const PointerPath &a, const PointerPath &b)
+{
+  if (a.module != b.module)
+  {
+    return a.module < b.module;
+  }
+  if (a.base_offset != b.base_offset)
+  {
+    return a.base_offset < b.base_offset;
+  }
+  if (a.depth != b.depth)
+  {
+    return a.depth < b.depth;
+  }
+  return std::lexicographical_compare(a.offsets, a.offsets + a.depth, b.offsets, b.offsets + b.depth);
+}
+
+bool write_pointer_scan(const std::string &file, const std::vector<std::string> &modules, uint32_t capacity,
+                        const std::vector<PointerPath> &paths, std::string &error)
+{
+  std::string names;
+  for (const std::string &module : modules)
+  {
+    names.append(module.c_str(), module.size() + 1);
+  }
+  PointerScanFileHeader header;
+  memcpy(header.magic, pointer_scan_magic, 8);
+  header.depth_capacity = capacity;
+  header.module_count = modules.size();
+  header.count = paths.size();
+  header.names_size = names.size();
+
+  std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+  out.write((const char *)&header, sizeof(header));
+  out.write(names.data(), names.size());
+  for (const PointerPath &path : paths)
+  {
+    out.write((const char *)&path, offsetof(PointerPath, offsets) + capacity * sizeof(uint32_t));
+  }
+  out.close();
+  if (!out)
+  {
+    error = "Could not write " + file;
+    return false;
+  }
+  return true;
+}
+
+// A pointer scan file mapped read-only.
+class PointerScanFile
+{
+public:
+  ~PointerScanFile()
+  {
+    if (data)
+    {
+      munmap((void *)data, size);
+    }
+  }
+
+  bool open_file(const std::string &file, std::string &error)
+  {
+    error = "Not a pointer scan file: " + file;
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PointerScanFileHeader))
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      return false;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      return false;
+    }
+    data = (const unsigned char *)mapped;
+    size = st.st_size;
+
+    memcpy(&header, data, sizeof(header));
+    record_size = offsetof(PointerPath, offsets) + header.depth_capacity * sizeof(uint32_t);
+    if (memcmp(header.magic, pointer_scan_magic, 8) != 0 || header.depth_capacity > pointer_scan_max_depth ||
+        header.names_size > size - sizeof(header) ||
+        header.count > (size - sizeof(header) - header.names_size) / record_size ||
+        (header.names_size > 0 && data[sizeof(header) + header.names_size - 1] != 0))
+    {
+      return false;
+    }
+    for (const char *name = (const char *)data + sizeof(header); modules.size() < header.module_count;)
+    {
+      if (name >= (const char *)data + sizeof(header) + header.names_size)
+      {
+        return false;
+      }
+      modules.push_back(name);
+      name += modules.back().size() + 1;
+    }
+    return true;
+  }
+
+  size_t count() const
+  {
+    return header.count;
+  }
+
+  PointerPath path(size_t i) const
+  {
+    PointerPath path = {};
+    memcpy(&path, data + sizeof(header) + header.names_size + i * record_size, record_size);
+    path.depth = std::min(path.depth, header.depth_capacity);
+    return path;
+  }
+
+  PointerScanFileHeader header;
+  std::vector<std::string> modules;
+
+private:
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+  size_t record_size = 0;
+};
+
+bool run_pointer_scan(ProcessMemory &proc, const ProcessMaps &maps, unsigned long long target,
+                      const PointerScanOptions &options, PointerScanStats &stats,
+                      const std::atomic<bool> *cancelled, std::string &error)
+{
+  auto started = std::chrono::steady_clock::now();
+  SnapshotLayer index;
+  if (!build_pointer_index(proc, maps, options, index, stats, cancelled, error))
+  {
+    return false;
+  }
+  auto indexed = std::chrono::steady_clock::now();
+  stats.index_seconds = std::chrono::duration<double>(indexed - started).count();
+
+  PointerSearch search(maps, reinterpret_cast<const PointerPair *>(index.data), stats.pointers, options, cancelled);
+  std::vector<PointerPath> paths;
+
+  // Breadth first until there is enough work to share out, then each
+  // thread walks its part of the frontier depth first.
+  size_t threads = options.scan.threads ? options.scan.threads : WorkerPool::shared().size() + 1;
+  std::vector<PointerSearch::Node> frontier(1);
+  frontier[0].address = target;
+  frontier[0].depth = 0;
+  while (!frontier.empty() && frontier.size() < threads * 16 && !search.stopped())
+  {
+    std::vector<PointerSearch::Node> next;
+    for (const PointerSearch::Node &node : frontier)
+    {
+      search.expand(node, paths, [&](const PointerSearch::Node &child)
+                    { next.push_back(child); });
+    }
+    frontier.swap(next);
+  }
+
+  std::mutex paths_mutex;
+  WorkerPool::shared().parallel_for(frontier.size(), threads, [&](size_t i)
+                                    {
+    std::vector<PointerPath> found;
+    search.walk(frontier[i], found);
+    std::lock_guard<std::mutex> lock(paths_mutex);
+    paths.insert(paths.end(), found.begin(), found.end()); });
+
+  if (cancelled && *cancelled)
+  {
+    error = "Pointer scan cancelled";
+    return false;
+  }
+  if (paths.size() > options.scan.max_results)
+  {
+    paths.resize(options.scan.max_results);
+  }
+  std::sort(paths.begin(), paths.end(), path_less);
+  stats.paths = paths.size();
+  stats.truncated = search.truncated;
+  stats.search_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - indexed).count();
+  return write_pointer_scan(options.output, search.modules, options.max_depth, paths, error);
+}
+
+Napi::Object pointer_scan_result(Napi::Env env, const PointerScanStats &stats)
+{
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, stats.paths));
+  result.Set("truncated", Napi::Boolean::New(env, stats.truncated));
+  result.Set("pointers", Napi::Number::New(env, stats.pointers));
+  result.Set("bytesScanned", Napi::Number::New(env, stats.bytes_scanned));
+  result.Set("bytesSkipped", Napi::Number::New(env, stats.bytes_skipped));
+  result.Set("indexSeconds", Napi::Number::New(env, stats.index_seconds));
+  result.Set("searchSeconds", Napi::Number::New(env, stats.search_seconds));
+  return result;
+}
+
+// pointer_scan(pid, target, options) writes the pointer paths reaching
+// target to options.output and returns { count, truncated, pointers,
+// bytesScanned, bytesSkipped, indexSeconds, searchSeconds }. Options:
+// maxDepth (5, at most 16), maxOffset (0x1000), maxResults (1000000),
+// modules to restrict the static bases to, cacheDir for the index, and the
+// scan options (rw regions, alignment 8, threads, skipNonResident).
+Napi::Value pointer_scan(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  unsigned long long target;
+  PointerScanOptions options;
+  if (!get_address(info[1], target) || !get_pointer_scan_options(info[2], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
+  {
+    return env.Null();
+  }
+
+  PointerScanStats stats;
+  std::string error;
+  if (!run_pointer_scan(*proc, *maps, target, options, stats, nullptr, error))
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return pointer_scan_result(env, stats);
+}
+
+// read_pointer_scan(file, { offset, limit }) returns { count, paths }, paths
+// being [{ module, name, offsets }] with the module's path and file name,
+// ready for resolve_pointer_chain(pid, get_module_base(pid, module), offsets).
+Napi::Value read_pointer_scan(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!info[0].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t offset = 0;
+  size_t limit = 1000;
+  if (info.Length() > 1 && info[1].IsObject())
+  {
+    Napi::Object options = info[1].As<Napi::Object>();
+    if (options.Has("offset"))
+    {
+      offset = options.Get("offset").ToNumber().Int64Value();
+    }
+    if (options.Has("limit"))
+    {
+      limit = options.Get("limit").ToNumber().Int64Value();
+    }
+  }
+
+  PointerScanFile file;
+  std::string error;
+  if (!file.open_file(info[0].As<Napi::String>().Utf8Value(), error))
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t end = std::min(file.count(), offset + std::min(limit, file.count()));
+  Napi::Array paths = Napi::Array::New(env);
+  for (size_t i = offset; i < end; ++i)
+  {
+    PointerPath path = file.path(i);
+    Napi::Array offsets = Napi::Array::New(env, path.depth + 1);
+    offsets.Set((uint32_t)0, Napi::Number::New(env, path.base_offset));
+    for (uint32_t k = 0; k < path.depth; ++k)
+    {
+      offsets.Set(k + 1, Napi::Number::New(env, path.offsets[k]));
+    }
+    Napi::Object item = Napi::Object::New(env);
+    bool known = path.module >= 0 && (size_t)path.module < file.modules.size();
+    item.Set("module", known ? (Napi::Value)Napi::String::New(env, file.modules[path.module]) : env.Null());
+    item.Set("name", known ? (Napi::Value)Napi::String::New(env, path_basename(file.modules[path.module])) : env.Null());
+    item.Set("offsets", offsets);
+    paths.Set(i - offset, item);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, file.count()));
+  result.Set("paths", paths);
+  return result;
+}
+
+// intersect_pointer_scans(a, b, output) writes the paths present in both
+// files, typically from runs before and after a restart, and returns their
+// count. Modules are matched by path, or by file name when that is unique.
+Napi::Value intersect_pointer_scans(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!info[0].IsString() || !info[1].IsString() || !info[2].IsString())
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  PointerScanFile a, b;
+  std::string error;
+  if (!a.open_file(info[0].As<Napi::String>().Utf8Value(), error) ||
+      !b.open_file(info[1].As<Napi::String>().Utf8Value(), error))
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // b's modules in a's table: the same path, or else the only module of a
+  // with the same file name, as after an install to a different prefix.
+  std::vector<int32_t> remap(b.modules.size(), -1);
+  for (size_t i = 0; i < b.modules.size(); ++i)
+  {
+    int32_t same_name = -1;
+    size_t named = 0;
+    for (size_t k = 0; k < a.modules.size() && remap[i] < 0; ++k)
+    {
+      if (a.modules[k] == b.modules[i])
+      {
+        remap[i] = k;
+      }
+      else if (path_basename(a.modules[k]) == path_basename(b.modules[i]))
+      {
+        same_name = k;
+        named++;
+      }
+    }
+    if (remap[i] < 0 && named == 1)
+    {
+      remap[i] = same_name;
+    }
+  }
+
+  // Renumbering can change the order of b's records, so they are sorted
+  // again before the merge.
+  std::vector<PointerPath> right;
+  for (size_t j = 0; j < b.count(); ++j)
+  {
+    PointerPath path = b.path(j);
+    if (path.module >= 0 && (size_t)path.module < remap.size() && remap[path.module] >= 0)
+    {
+      path.module = remap[path.module];
+      right.push_back(path);
+    }
+  }
+  std::sort(right.begin(), right.end(), path_less);
+
+  std::vector<PointerPath> both;
+  size_t i = 0, j = 0;
+  while (i < a.count() && j < right.size())
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
+    PointerPath left = a.path(i);
+    if (path_less(left, right[j]))
+    {
+      ++i;
+    }
+    else if (path_less(right[j], left))
+    {
+      ++j;
+    }
+    else
+    {
+      both.push_back(left);
+      ++i;
+      ++j;
+    }
+  }
+
+  if (!write_pointer_scan(info[2].As<Napi::String>().Utf8Value(), a.modules, a.header.depth_capacity, both, error))
+  {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
     return env.Null();
   }
+  return Napi::Number::New(env, both.size());
+}
 
-  Window *window_list = (Window *)data;
-  std::string window_title = "";
+// dump_memory(): copies whole regions into a file the caller names, for
+// full-process dumps and large snapshots. The file is sized up front and
+// mapped shared, so finished data lands in it without a write(). Two
+// backends read /proc/<pid>/mem:
+//   io_uring  one thread keeps queueDepth reads of up to blockSize in
+//             flight on a ring into staging buffers, which are memcpy'd
+//             into the mapping as each read completes. The buffers are
+//             registered with the kernel (pinned once, not per read) when
+//             it allows; otherwise the same buffers take plain reads.
+//   pread     the worker pool runs plain preads straight into the mapping.
+// "auto" takes io_uring and falls back to pread when the kernel or its
+// io_uring_disabled setting refuses a ring. Pages that cannot be read stay
+// zero in the file and are counted as failed.
+enum DumpBackend
+{
+  DUMP_AUTO,
+  DUMP_IO_URING,
+  DUMP_PREAD,
+};
 
-  for (unsigned long i = 0; i < num_windows; ++i)
+struct DumpOptions
+{
+  ScanOptions scan;
+  DumpBackend backend = DUMP_AUTO;
+  unsigned queue_depth = 32;
+  std::string output;
+
+  DumpOptions()
   {
-    Window window = window_list[i];
-    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-    Atom pid_type;
-    int pid_format;
-    unsigned long pid_nitems, pid_bytes_remaining;
-    unsigned char *pid_data = NULL;
+    scan.block_size = 1 << 20;
+  }
+};
 
-    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+struct DumpChunk
+{
+  unsigned long long start;
+  size_t len;
+  size_t out_offset;
+};
+
+struct DumpStats
+{
+  const char *backend = "pread";
+  bool registered_buffers = false;
+  unsigned long long bytes = 0;
+  unsigned long long bytes_failed = 0;
+  double seconds = 0;
+};
+
+bool get_dump_options(const Napi::Value &value, DumpOptions &options)
+{
+  if (!value.IsObject() || !value.As<Napi::Object>().Get("output").IsString() || !get_scan_options(value, options.scan))
+  {
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  options.output = object.Get("output").As<Napi::String>().Utf8Value();
+  if (object.Has("queueDepth"))
+  {
+    options.queue_depth = std::min(4096u, std::max(1u, object.Get("queueDepth").ToNumber().Uint32Value()));
+  }
+  if (object.Has("backend"))
+  {
+    std::string backend = object.Get("backend").ToString().Utf8Value();
+    if (backend == "io_uring")
     {
-      if (pid_data != NULL)
+      options.backend = DUMP_IO_URING;
+    }
+    else if (backend == "pread")
+    {
+      options.backend = DUMP_PREAD;
+    }
+    else if (backend != "auto")
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads chunk into out with preads, skipping the pages that fail.
+void pread_chunk(ProcessMemory &proc, const DumpChunk &chunk, unsigned char *out, std::atomic<unsigned long long> &bytes,
+                 std::atomic<unsigned long long> &failed)
+{
+  const unsigned long long page = 4096;
+  size_t offset = 0;
+  while (offset < chunk.len && !proc.exited)
+  {
+    ssize_t n = read_memory(proc, chunk.start + offset, out + chunk.out_offset + offset, chunk.len - offset);
+    if (n > 0)
+    {
+      offset += n;
+      bytes += n;
+      continue;
+    }
+    size_t next = std::min<size_t>((((chunk.start + offset) | (page - 1)) + 1) - chunk.start, chunk.len);
+    failed += next - offset;
+    offset = next;
+  }
+}
+
+#if defined(SYS_io_uring_setup) && defined(IORING_OFF_SQ_RING)
+// The rings of an io_uring instance, set up with raw syscalls.
+class IoUring
+{
+public:
+  ~IoUring()
+  {
+    if (sqes != MAP_FAILED)
+    {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+    {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED)
+    {
+      munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+
+  bool setup(unsigned entries)
+  {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = syscall(SYS_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED)
+    {
+      return false;
+    }
+    cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring
+                                                         : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+    {
+      return false;
+    }
+
+    unsigned char *sq = (unsigned char *)sq_ring;
+    unsigned char *cq = (unsigned char *)cq_ring;
+    sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq + params.sq_off.array);
+    cq_head = (unsigned *)(cq + params.cq_off.head);
+    cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  bool register_buffers(const struct iovec *iovecs, unsigned count)
+  {
+    return syscall(SYS_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs, count) == 0;
+  }
+
+  // Queues a read of len bytes at offset of file into buf; buf_index is the
+  // registered buffer holding buf, or -1.
+  void read(int file, void *buf, size_t len, unsigned long long offset, int buf_index, unsigned long long user_data)
+  {
+    unsigned tail = *sq_tail;
+    unsigned index = tail & sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = buf_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = file;
+    sqe->addr = (unsigned long long)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->buf_index = buf_index >= 0 ? buf_index : 0;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    pending++;
+  }
+
+  // Submits the queued reads and waits for at least one completion.
+  bool submit_and_wait()
+  {
+    while (true)
+    {
+      int n = syscall(SYS_io_uring_enter, fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (n >= 0)
       {
-        pid_t pid = *((pid_t *)pid_data);
-        XFree(pid_data);
+        pending -= n;
+        return true;
+      }
+      if (errno != EINTR)
+      {
+        return false;
+      }
+    }
+  }
 
-        if (pid == target_pid)
+  // Calls done(user_data, res) for every completion posted so far.
+  template <typename Done>
+  void reap(Done done)
+  {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+      const struct io_uring_cqe &cqe = cqes[head & cq_mask];
+      done(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  int fd = -1;
+  unsigned pending = 0;
+  void *sq_ring = MAP_FAILED;
+  void *cq_ring = MAP_FAILED;
+  void *sqes = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  size_t cq_ring_size = 0;
+  size_t sqes_size = 0;
+  unsigned *sq_tail = nullptr;
+  unsigned sq_mask = 0;
+  unsigned *sq_array = nullptr;
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned cq_mask = 0;
+  struct io_uring_cqe *cqes = nullptr;
+};
+
+// Reads the chunks through one ring. Each of the queue_depth slots owns a
+// staging buffer and works through one chunk at a time, resubmitting short
+// reads and stepping over pages that fail. Returns false without reading
+// anything if no ring can be set up.
+bool io_uring_dump(ProcessMemory &proc, const std::vector<DumpChunk> &chunks, unsigned char *out, const DumpOptions &options,
+                   DumpStats &stats, const std::atomic<bool> *cancelled)
+{
+  const unsigned long long page = 4096;
+  unsigned depth = std::min<size_t>(options.queue_depth, std::max<size_t>(chunks.size(), 1));
+  size_t block = options.scan.block_size;
+  SnapshotLayer staging;
+  std::string error;
+  IoUring ring;
+  if (!staging.map(block * depth, std::string(), error) || !ring.setup(depth))
+  {
+    return false;
+  }
+  std::vector<struct iovec> iovecs(depth);
+  for (unsigned i = 0; i < depth; ++i)
+  {
+    iovecs[i].iov_base = staging.data + i * block;
+    iovecs[i].iov_len = block;
+  }
+  // Registration can fail on RLIMIT_MEMLOCK; plain reads into the same
+  // buffers still work.
+  stats.registered_buffers = ring.register_buffers(iovecs.data(), depth);
+  stats.backend = "io_uring";
+
+  struct Slot
+  {
+    size_t chunk;
+    size_t done;
+    bool busy;
+  };
+  std::vector<Slot> slots(depth, Slot{0, 0, false});
+  size_t next_chunk = 0;
+  unsigned in_flight = 0;
+  unsigned long long bytes = 0;
+  unsigned long long failed = 0;
+
+  auto submit = [&](unsigned slot)
+  {
+    const DumpChunk &chunk = chunks[slots[slot].chunk];
+    size_t done = slots[slot].done;
+    ring.read(proc.fd, staging.data + slot * block + done, chunk.len - done, chunk.start + done,
+              stats.registered_buffers ? (int)slot : -1, slot);
+    slots[slot].busy = true;
+    in_flight++;
+  };
+  auto start_next = [&](unsigned slot)
+  {
+    if (next_chunk < chunks.size() && !proc.exited && !(cancelled && *cancelled))
+    {
+      slots[slot].chunk = next_chunk++;
+      slots[slot].done = 0;
+      submit(slot);
+    }
+  };
+
+  auto completed = [&](unsigned long long slot, int res)
+  {
+    in_flight--;
+    Slot &state = slots[slot];
+    state.busy = false;
+    const DumpChunk &chunk = chunks[state.chunk];
+    if (res > 0)
+    {
+      memcpy(out + chunk.out_offset + state.done, staging.data + slot * block + state.done, res);
+      state.done += res;
+      bytes += res;
+    }
+    else if (res != -EINTR && res != -EAGAIN)
+    {
+      process_alive(proc);
+      size_t next = std::min<size_t>((((chunk.start + state.done) | (page - 1)) + 1) - chunk.start, chunk.len);
+      failed += next - state.done;
+      state.done = next;
+    }
+    if (state.done < chunk.len && !proc.exited && !(cancelled && *cancelled))
+    {
+      submit(slot);
+    }
+    else
+    {
+      start_next(slot);
+    }
+  };
+
+  for (unsigned slot = 0; slot < depth; ++slot)
+  {
+    start_next(slot);
+  }
+  int retries = 0;
+  while (in_flight > 0)
+  {
+    if (!ring.submit_and_wait())
+    {
+      // EAGAIN and EBUSY mean the kernel is short of resources for now;
+      // reap whatever completed and try again a little later.
+      if ((errno == EAGAIN || errno == EBUSY) && ++retries <= 1000)
+      {
+        ring.reap([&](unsigned long long slot, int res)
+                  { completed(slot, res); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      // Nothing can be waited for any more; the ring teardown cancels what
+      // is still queued. Before anything completed, pread can still do it
+      // all. Otherwise whatever is unread is counted as failed.
+      if (bytes == 0 && failed == 0)
+      {
+        int saved = errno;
+        stats.registered_buffers = false;
+        errno = saved;
+        return false;
+      }
+      for (unsigned slot = 0; slot < depth; ++slot)
+      {
+        if (slots[slot].busy)
         {
-          char *name;
-          if (XFetchName(display, window, &name) > 0)
-          {
-            window_title = std::string(name);
-            XFree(name);
-            break;
-          }
+          failed += chunks[slots[slot].chunk].len - slots[slot].done;
         }
       }
+      for (; next_chunk < chunks.size(); ++next_chunk)
+      {
+        failed += chunks[next_chunk].len;
+      }
+      break;
     }
+    retries = 0;
+    ring.reap([&](unsigned long long slot, int res)
+              { completed(slot, res); });
   }
 
-  XFree(window_list);
-  XCloseDisplay(display);
+  count_bytes_read(bytes);
+  stats.bytes = bytes;
+  stats.bytes_failed = failed;
+  return true;
+}
+#else
+bool io_uring_dump(ProcessMemory &proc, const std::vector<DumpChunk> &chunks, unsigned char *out, const DumpOptions &options,
+                   DumpStats &stats, const std::atomic<bool> *cancelled)
+{
+  errno = ENOSYS;
+  return false;
+}
+#endif
 
-  if (!window_title.empty())
+// Lays the regions out back to back in options.output, reads them in, and
+// fills layout with (start, end, file offset) for each.
+bool run_dump(ProcessMemory &proc, const ProcessMaps &maps, const DumpOptions &options, std::vector<DumpChunk> &layout,
+              DumpStats &stats, const std::atomic<bool> *cancelled, std::string &error)
+{
+  auto started = std::chrono::steady_clock::now();
+  std::vector<std::pair<unsigned long long, unsigned long long>> spans = filter_spans(maps, options.scan.filter);
+  std::vector<DumpChunk> chunks;
+  size_t total = 0;
+  for (const auto &span : spans)
   {
-    return Napi::String::New(env, window_title);
+    layout.push_back({span.first, (size_t)(span.second - span.first), total});
+    for (unsigned long long start = span.first; start < span.second; start += options.scan.block_size)
+    {
+      size_t len = std::min<unsigned long long>(options.scan.block_size, span.second - start);
+      chunks.push_back({start, len, total + (size_t)(start - span.first)});
+    }
+    total += span.second - span.first;
   }
-  else
+
+  int fd = open(options.output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || ftruncate(fd, total) != 0)
   {
-    Napi::Error::New(env, "Window with the specified PID not found").ThrowAsJavaScriptException();
-    return env.Null();
+    error = "Could not create " + options.output + ": " + strerror(errno);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return false;
+  }
+  void *mapped = total ? mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : nullptr;
+  close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    error = "Could not map " + options.output + ": " + strerror(errno);
+    return false;
+  }
+  unsigned char *out = (unsigned char *)mapped;
+
+  bool done = options.backend != DUMP_PREAD && io_uring_dump(proc, chunks, out, options, stats, cancelled);
+  if (!done && options.backend == DUMP_IO_URING)
+  {
+    error = std::string("io_uring is not available: ") + strerror(errno);
+    munmap(mapped, total);
+    return false;
+  }
+  if (!done)
+  {
+    std::atomic<unsigned long long> bytes(0);
+    std::atomic<unsigned long long> failed(0);
+    WorkerPool &pool = WorkerPool::shared();
+    pool.parallel_for(chunks.size(), options.scan.threads ? options.scan.threads : pool.size() + 1, [&](size_t i)
+                      {
+      if (!(cancelled && *cancelled))
+      {
+        pread_chunk(proc, chunks[i], out, bytes, failed);
+      } });
+    stats.backend = "pread";
+    stats.bytes = bytes;
+    stats.bytes_failed = failed;
   }
+  if (total)
+  {
+    munmap(mapped, total);
+  }
+
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  if (proc.exited)
+  {
+    error = "Process " + std::to_string(proc.pid) + " has exited";
+    return false;
+  }
+  if (cancelled && *cancelled)
+  {
+    error = "Dump cancelled";
+    return false;
+  }
+  return true;
 }
 
-Napi::Value disable_window_input(const Napi::CallbackInfo &info)
+Napi::Object dump_result(Napi::Env env, const std::vector<DumpChunk> &layout, const DumpStats &stats)
+{
+  Napi::Array regions = Napi::Array::New(env, layout.size());
+  for (size_t i = 0; i < layout.size(); ++i)
+  {
+    Napi::Object region = Napi::Object::New(env);
+    region.Set("start", Napi::BigInt::New(env, (uint64_t)layout[i].start));
+    region.Set("end", Napi::BigInt::New(env, (uint64_t)(layout[i].start + layout[i].len)));
+    region.Set("offset", Napi::Number::New(env, layout[i].out_offset));
+    regions.Set(i, region);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("regions", regions);
+  result.Set("backend", Napi::String::New(env, stats.backend));
+  result.Set("registeredBuffers", Napi::Boolean::New(env, stats.registered_buffers));
+  result.Set("bytes", Napi::Number::New(env, stats.bytes));
+  result.Set("bytesFailed", Napi::Number::New(env, stats.bytes_failed));
+  result.Set("seconds", Napi::Number::New(env, stats.seconds));
+  result.Set("bytesPerSecond", Napi::Number::New(env, stats.seconds > 0 ? stats.bytes / stats.seconds : 0));
+  return result;
+}
+
+// dump_memory(pid, options) copies the regions chosen by the region filter
+// (readable ones by default) into options.output and returns { regions:
+// [{ start, end, offset }], backend, registeredBuffers, bytes, bytesFailed,
+// seconds, bytesPerSecond }. Options: backend ("auto", "io_uring" or
+// "pread"), queueDepth (32), blockSize (1 MiB) and threads for pread.
+Napi::Value dump_memory(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
-  if (info.Length() < 1)
+  if (info.Length() < 2)
   {
     Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!info[0].IsNumber())
+  DumpOptions options;
+  if (!get_dump_options(info[1], options))
   {
     Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
-
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  std::vector<DumpChunk> layout;
+  DumpStats stats;
+  std::string error;
+  if (!run_dump(*proc, *maps, options, layout, stats, nullptr, error))
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
     return env.Null();
   }
+  return dump_result(env, layout, stats);
+}
 
-  Window *window_list = (Window *)data;
+// True unless options.signal is there but is not an AbortSignal-like
+// object. Checked before a worker is allocated, so a bad signal cannot
+// throw out of watch_signal and leak it.
+bool valid_signal(const Napi::Value &options)
+{
+  if (!options.IsObject() || !options.As<Napi::Object>().Get("signal").IsObject())
+  {
+    return true;
+  }
+  Napi::Object signal = options.As<Napi::Object>().Get("signal").As<Napi::Object>();
+  return signal.Get("addEventListener").IsFunction() && signal.Get("removeEventListener").IsFunction();
+}
 
-  for (unsigned long i = 0; i < num_windows; ++i)
+// Base for the *_async exports: runs Execute on the libuv thread pool and
+// settles a Promise with result() or the error. An AbortSignal passed as
+// options.signal sets the cancelled flag, which Execute polls, and the
+// Promise then rejects with the signal's reason.
+class PromiseWorker : public Napi::AsyncWorker
+{
+public:
+  PromiseWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc)
+      : Napi::AsyncWorker(env), proc(proc), export_id(current_export), deferred(Napi::Promise::Deferred::New(env)),
+        cancelled(std::make_shared<std::atomic<bool>>(false))
   {
-    Window window = window_list[i];
-    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-    Atom pid_type;
-    int pid_format;
-    unsigned long pid_nitems, pid_bytes_remaining;
-    unsigned char *pid_data = NULL;
+  }
 
-    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
+  // Hooks options.signal up to the cancelled flag. Returns false if the
+  // signal has already fired, in which case the Promise is rejected.
+  bool watch_signal(const Napi::Value &options)
+  {
+    if (!options.IsObject() || !options.As<Napi::Object>().Get("signal").IsObject())
     {
-      if (pid_data != NULL)
-      {
-        pid_t pid = *((pid_t *)pid_data);
-        XFree(pid_data);
+      return true;
+    }
 
-        if (pid == target_pid)
-        {
-          // Disable input for the window
-          XSelectInput(display, window, 0);
+    Napi::Object abort_signal = options.As<Napi::Object>().Get("signal").As<Napi::Object>();
+    signal = Napi::Persistent(abort_signal);
+    if (abort_signal.Get("aborted").ToBoolean())
+    {
+      reject_aborted();
+      return false;
+    }
 
-          // Make the window passthrough
-          XserverRegion region = XFixesCreateRegion(display, NULL, 0);
-          XFixesSetWindowShapeRegion(display, window, ShapeInput, 0, 0, region);
-          XFixesDestroyRegion(display, region);
+    std::shared_ptr<std::atomic<bool>> flag = cancelled;
+    listener = Napi::Persistent(Napi::Function::New(Env(), [flag](const Napi::CallbackInfo &info)
+                                                    { *flag = true; }));
+    abort_signal.Get("addEventListener").As<Napi::Function>().Call(abort_signal, {Napi::String::New(Env(), "abort"), listener.Value()});
+    return true;
+  }
+
+  Napi::Promise promise() const
+  {
+    return deferred.Promise();
+  }
+
+protected:
+  virtual Napi::Value result(Napi::Env env) = 0;
+
+  bool is_cancelled() const
+  {
+    return *cancelled;
+  }
+
+  const std::atomic<bool> *cancel_flag() const
+  {
+    return cancelled.get();
+  }
 
-          break;
-        }
-      }
+  void OnOK() override
+  {
+    unwatch_signal();
+    if (*cancelled)
+    {
+      reject_aborted();
+      return;
     }
+    deferred.Resolve(result(Env()));
   }
 
-  XFree(window_list);
-  XCloseDisplay(display);
-
-  return env.Null();
-}
+  void OnError(const Napi::Error &e) override
+  {
+    unwatch_signal();
+    if (*cancelled)
+    {
+      reject_aborted();
+      return;
+    }
+    deferred.Reject(e.Value());
+  }
 
-Napi::Value enable_window_input(const Napi::CallbackInfo &info)
-{
-  Napi::Env env = info.Env();
+  std::shared_ptr<ProcessMemory> proc;
+  // Execute runs on a libuv thread; each opens an ExportScope on this so its
+  // reads count to the export that queued it.
+  int export_id;
 
-  if (info.Length() < 1)
+private:
+  void reject_aborted()
   {
-    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
-    return env.Null();
+    Napi::Value reason = signal.Value().Get("reason");
+    if (reason.IsUndefined())
+    {
+      Napi::Error error = Napi::Error::New(Env(), "The operation was aborted");
+      error.Value().Set("name", Napi::String::New(Env(), "AbortError"));
+      reason = error.Value();
+    }
+    deferred.Reject(reason);
   }
 
-  if (!info[0].IsNumber())
+  void unwatch_signal()
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
-    return env.Null();
+    if (!listener.IsEmpty())
+    {
+      Napi::Object abort_signal = signal.Value();
+      abort_signal.Get("removeEventListener").As<Napi::Function>().Call(abort_signal, {Napi::String::New(Env(), "abort"), listener.Value()});
+      listener.Reset();
+    }
   }
 
-  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+  Napi::Promise::Deferred deferred;
+  std::shared_ptr<std::atomic<bool>> cancelled;
+  Napi::ObjectReference signal;
+  Napi::FunctionReference listener;
+};
 
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+class SigscanWorker : public PromiseWorker
+{
+public:
+  SigscanWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, unsigned long long start_addr)
+      : PromiseWorker(env, proc), start_addr(start_addr), found(false), address(0)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
-    return env.Null();
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
+  std::shared_ptr<const Signature> sig;
 
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+protected:
+  void Execute() override
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
-    return env.Null();
+    ExportScope scope(export_id);
+    found = scan_signature(*proc, start_addr, *sig, address, cancel_flag());
   }
 
-  Window *window_list = (Window *)data;
-
-  for (unsigned long i = 0; i < num_windows; ++i)
+  Napi::Value result(Napi::Env env) override
   {
-    Window window = window_list[i];
-    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-    Atom pid_type;
-    int pid_format;
-    unsigned long pid_nitems, pid_bytes_remaining;
-    unsigned char *pid_data = NULL;
+    return found ? Napi::Number::New(env, address) : env.Null();
+  }
 
-    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
-    {
-      if (pid_data != NULL)
-      {
-        pid_t pid = *((pid_t *)pid_data);
-        XFree(pid_data);
+private:
+  unsigned long long start_addr;
+  bool found;
+  unsigned long long address;
+};
 
-        if (pid == target_pid)
-        {
-          // Enable input for the window
-          XSelectInput(display, window, StructureNotifyMask | SubstructureNotifyMask);
+class SigscanRegionsWorker : public PromiseWorker
+{
+public:
+  SigscanRegionsWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, std::shared_ptr<const ProcessMaps> maps)
+      : PromiseWorker(env, proc), maps(maps), found(false), address(0)
+  {
+  }
 
-          // Reset the input shape
-          XShapeCombineMask(display, window, ShapeInput, 0, 0, None, ShapeSet);
+  std::shared_ptr<const Signature> sig;
+  ScanOptions options;
 
-          break;
-        }
-      }
+protected:
+  void Execute() override
+  {
+    ExportScope scope(export_id);
+    found = scan_regions(*proc, *maps, *sig, options, address, stats, cancel_flag());
+    if (proc->exited)
+    {
+      SetError("Process " + std::to_string(proc->pid) + " has exited");
     }
   }
 
-  XFree(window_list);
-  XCloseDisplay(display);
+  Napi::Value result(Napi::Env env) override
+  {
+    return scan_result(env, found, address, stats);
+  }
 
-  return env.Null();
-}
+private:
+  std::shared_ptr<const ProcessMaps> maps;
+  bool found;
+  unsigned long long address;
+  ScanStats stats;
+};
 
-Napi::Value make_window_topmost(const Napi::CallbackInfo &info)
+Napi::Value sigscan_async(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
-  if (info.Length() < 1)
+  if (info.Length() >= 2 && is_signature(info[1]))
+  {
+    std::shared_ptr<const Signature> sig = get_signature(env, info[1]);
+    if (!sig)
+    {
+      return env.Null();
+    }
+    std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+    if (!proc)
+    {
+      return env.Null();
+    }
+    std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+    if (!maps)
+    {
+      return env.Null();
+    }
+
+    if (!valid_signal(info[2]))
+    {
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    SigscanRegionsWorker *worker = new SigscanRegionsWorker(env, proc, maps);
+    if (!get_scan_options(info[2], worker->options))
+    {
+      delete worker;
+      Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    worker->sig = sig;
+    Napi::Promise promise = worker->promise();
+    if (worker->watch_signal(info[2]))
+    {
+      worker->Queue();
+    }
+    else
+    {
+      delete worker;
+    }
+    return promise;
+  }
+
+  if (info.Length() < 3)
   {
     Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!info[0].IsNumber())
+  unsigned long long start_addr;
+  if (!get_address(info[1], start_addr) || !is_signature(info[2]))
   {
     Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
+  std::shared_ptr<const Signature> sig = get_signature(env, info[2]);
+  if (!sig)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
 
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+  if (!valid_signal(info[3]))
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
+  SigscanWorker *worker = new SigscanWorker(env, proc, start_addr);
+  worker->sig = sig;
+  Napi::Promise promise = worker->promise();
+  if (worker->watch_signal(info[3]))
+  {
+    worker->Queue();
+  }
+  else
+  {
+    delete worker;
+  }
+  return promise;
+}
 
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+// sigscan_all_async: with options.onResults, matches are streamed to it in
+// ascending order as BigUint64Array chunks of up to chunkSize (4096)
+// addresses through a thread-safe function, and the Promise resolves with
+// the count and stats once the last chunk has been delivered. Without it,
+// the Promise resolves with what sigscan_all returns.
+class SigscanAllWorker : public PromiseWorker
+{
+public:
+  SigscanAllWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, std::shared_ptr<const ProcessMaps> maps)
+      : PromiseWorker(env, proc), maps(maps), streaming(false), chunk_size(4096), count(0), truncated(false), in_flight(0)
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
-    return env.Null();
   }
 
-  Window *window_list = (Window *)data;
+  std::shared_ptr<const Signature> sig;
+  ScanOptions options;
 
-  for (unsigned long i = 0; i < num_windows; ++i)
+  void stream_to(Napi::Function callback, size_t size)
   {
-    Window window = window_list[i];
-    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-    Atom pid_type;
-    int pid_format;
-    unsigned long pid_nitems, pid_bytes_remaining;
-    unsigned char *pid_data = NULL;
+    streaming = true;
+    chunk_size = std::max<size_t>(1, size);
+    on_results = Napi::ThreadSafeFunction::New(Env(), callback, "sigscan_all", 0, 1);
+  }
 
-    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
-    {
-      if (pid_data != NULL)
+protected:
+  void Execute() override
+  {
+    ExportScope scope(export_id);
+    std::vector<unsigned long long> pending;
+    count = scan_regions_all(*proc, *maps, *sig, options, [&](const unsigned long long *found, size_t n)
+                             {
+      if (!streaming)
       {
-        pid_t pid = *((pid_t *)pid_data);
-        XFree(pid_data);
-
-        if (pid == target_pid)
+        addresses.insert(addresses.end(), found, found + n);
+        return;
+      }
+      for (size_t i = 0; i < n; ++i)
+      {
+        pending.push_back(found[i]);
+        if (pending.size() == chunk_size)
         {
-          // Make the window topmost
-          XRaiseWindow(display, window);
-          break;
+          send(pending);
         }
+      } }, truncated, stats, cancel_flag());
+
+    if (streaming)
+    {
+      if (!pending.empty())
+      {
+        send(pending);
       }
+      // The Promise must not settle before JS has seen every chunk.
+      std::unique_lock<std::mutex> lock(chunk_mutex);
+      chunk_done.wait(lock, [&]
+                      { return in_flight == 0; });
+      lock.unlock();
+      on_results.Release();
+    }
+    if (proc->exited)
+    {
+      SetError("Process " + std::to_string(proc->pid) + " has exited");
     }
   }
 
-  XFree(window_list);
-  XCloseDisplay(display);
+  Napi::Value result(Napi::Env env) override
+  {
+    Napi::Object result = Napi::Object::New(env);
+    if (!streaming)
+    {
+      Napi::BigUint64Array array = Napi::BigUint64Array::New(env, addresses.size());
+      if (!addresses.empty())
+      {
+        memcpy(array.Data(), addresses.data(), addresses.size() * sizeof(uint64_t));
+      }
+      result.Set("addresses", array);
+    }
+    result.Set("count", Napi::Number::New(env, count));
+    result.Set("truncated", Napi::Boolean::New(env, truncated));
+    set_scan_stats(env, result, stats);
+    return result;
+  }
 
-  return env.Null();
-}
+private:
+  void send(std::vector<unsigned long long> &pending)
+  {
+    std::vector<unsigned long long> *chunk = new std::vector<unsigned long long>();
+    chunk->swap(pending);
+    {
+      std::lock_guard<std::mutex> lock(chunk_mutex);
+      in_flight++;
+    }
+    napi_status status = on_results.BlockingCall(chunk, [this](Napi::Env env, Napi::Function callback, std::vector<unsigned long long> *chunk)
+                                                 {
+      Napi::BigUint64Array array;
+      if (env != nullptr && callback != nullptr)
+      {
+        array = Napi::BigUint64Array::New(env, chunk->size());
+        memcpy(array.Data(), chunk->data(), chunk->size() * sizeof(uint64_t));
+      }
+      delete chunk;
+      chunk_finished();
+      if (env != nullptr && callback != nullptr)
+      {
+        callback.Call({array});
+      } });
+    if (status != napi_ok)
+    {
+      delete chunk;
+      chunk_finished();
+    }
+  }
 
-static void destroy_window_cb(GtkWidget *widget, GtkWidget *window)
-{
-  gtk_main_quit();
-}
+  void chunk_finished()
+  {
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    in_flight--;
+    chunk_done.notify_all();
+  }
 
-Napi::Value create_browser_window(const Napi::CallbackInfo &info)
+  std::shared_ptr<const ProcessMaps> maps;
+  bool streaming;
+  size_t chunk_size;
+  Napi::ThreadSafeFunction on_results;
+  std::vector<unsigned long long> addresses;
+  size_t count;
+  bool truncated;
+  ScanStats stats;
+  std::mutex chunk_mutex;
+  std::condition_variable chunk_done;
+  size_t in_flight;
+};
+
+Napi::Value sigscan_all_async(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
-  if (info.Length() < 1)
+  if (info.Length() < 2)
   {
     Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!info[0].IsString())
+  if (!is_signature(info[1]))
   {
     Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  std::string url = info[0].As<Napi::String>().Utf8Value();
-
-  std::thread([url]
-              {
- gtk_init(0, NULL);
+  std::shared_ptr<const Signature> sig = get_signature(env, info[1]);
+  if (!sig)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
+  {
+    return env.Null();
+  }
+  std::shared_ptr<const ProcessMaps> maps = get_process_maps(env, info[0], MAPS_CHECKED);
+  if (!maps)
+  {
+    return env.Null();
+  }
 
-    // Create a GTK window
-    GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_default_size(GTK_WINDOW(window), 800, 600);
-    g_signal_connect(window, "destroy", G_CALLBACK(destroy_window_cb), NULL);
-    gtk_window_set_title(GTK_WINDOW(window),"overlay-next-ag");
-    // Set window to fullscreen
-    // gtk_window_fullscreen(GTK_WINDOW(window));
+  if (!valid_signal(info[2]))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-             // Set window to borderless
-    gtk_window_set_decorated(GTK_WINDOW(window), FALSE);
+  SigscanAllWorker *worker = new SigscanAllWorker(env, proc, maps);
+  worker->sig = sig;
+  if (!get_scan_options(info[2], worker->options))
+  {
+    delete worker;
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-                // Set window position to (0, 0)
-    gtk_window_set_default_size(GTK_WINDOW(window), 1, 1);
-    gtk_window_move(GTK_WINDOW(window), 0, 0);
-    // Set window to transparent
-    GdkScreen *screen = gtk_window_get_screen(GTK_WINDOW(window));
-    GdkVisual *visual = gdk_screen_get_rgba_visual(screen);
+  // The ThreadSafeFunction is only released by Execute, so it must not be
+  // created for a worker that never runs.
+  Napi::Promise promise = worker->promise();
+  if (!worker->watch_signal(info[2]))
+  {
+    delete worker;
+    return promise;
+  }
+  if (info[2].IsObject() && info[2].As<Napi::Object>().Get("onResults").IsFunction())
+  {
+    Napi::Object options = info[2].As<Napi::Object>();
+    size_t chunk_size = options.Has("chunkSize") ? options.Get("chunkSize").ToNumber().Uint32Value() : 4096;
+    worker->stream_to(options.Get("onResults").As<Napi::Function>(), chunk_size);
+  }
+  worker->Queue();
+  return promise;
+}
 
-    if (visual != NULL && gdk_screen_is_composited(screen))
+// Reads len bytes into target. A Buffer allocated here is not reachable
+// from JS until the Promise settles, so the read goes straight into it. A
+// caller's target could be detached (transferred) while the read runs,
+// freeing its memory, so the read goes into a buffer the worker owns and is
+// copied over in OnOK, on the JS thread, if the target is still there.
+class ReadBytesWorker : public PromiseWorker
+{
+public:
+  ReadBytesWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, unsigned long long addr, size_t len,
+                  Napi::TypedArray target, bool caller_target)
+      : PromiseWorker(env, proc), addr(addr), target(Napi::Persistent(target)), len(len)
+  {
+    if (caller_target)
     {
-        gtk_widget_set_visual(window, visual);
-        gtk_widget_set_app_paintable(window, TRUE);
+      staging.resize(len);
+      dst = staging.data();
     }
+    else
+    {
+      dst = static_cast<unsigned char *>(target.ArrayBuffer().Data()) + target.ByteOffset();
+    }
+  }
 
-    // Create a WebKit web view and add it to the window
-    WebKitWebView *web_view = WEBKIT_WEB_VIEW(webkit_web_view_new());
-    gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(web_view));
-
-    // Set WebKitWebView background to transparent
-    GdkRGBA rgba = { .alpha = 0.0 };
-    webkit_web_view_set_background_color(web_view, &rgba);
-    gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(web_view));
+protected:
+  // Large reads go in 1 MiB pieces so a cancellation is noticed quickly.
+  void Execute() override
+  {
+    ExportScope scope(export_id);
+    const size_t piece = 1 << 20;
+    for (size_t done = 0; done < len && !is_cancelled(); done += piece)
+    {
+      size_t n = std::min(piece, len - done);
+      if (read_memory(*proc, addr + done, dst + done, n) != (ssize_t)n)
+      {
+        SetError(access_error(*proc, "read", addr + done));
+        return;
+      }
+    }
+  }
 
-    gtk_window_set_keep_above(GTK_WINDOW(window), TRUE);
-    // Load the specified URL
-    webkit_web_view_load_uri(web_view, url.c_str());
+  void OnOK() override
+  {
+    if (!staging.empty() && !is_cancelled())
+    {
+      // The typed array info gives the data pointer of a SharedArrayBuffer
+      // too, and null with a zero length once the buffer is detached.
+      Napi::TypedArray array = target.Value();
+      napi_typedarray_type array_type;
+      size_t length;
+      void *data = nullptr;
+      size_t offset;
+      if (napi_get_typedarray_info(Env(), array, &array_type, &length, &data, nullptr, &offset) != napi_ok || !data ||
+          array.ByteLength() < len)
+      {
+        OnError(Napi::RangeError::New(Env(), "Target buffer was detached or shrunk during the read"));
+        return;
+      }
+      memcpy(data, staging.data(), len);
+    }
+    PromiseWorker::OnOK();
+  }
 
-    // Show the window and run the GTK main loop
-    gtk_widget_show_all(window);
-    gtk_main(); })
-      .detach();
+  Napi::Value result(Napi::Env env) override
+  {
+    return target.Value();
+  }
 
-  return env.Null();
-}
+private:
+  unsigned long long addr;
+  Napi::Reference<Napi::TypedArray> target;
+  std::vector<unsigned char> staging;
+  unsigned char *dst;
+  size_t len;
+};
 
-Napi::Value set_window_size_by_pid(const Napi::CallbackInfo &info)
+// read_bytes_async(pid, address, length[, target][, options])
+Napi::Value read_bytes_async(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
-  if (info.Length() < 2)
+  if (info.Length() < 3)
   {
     Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
+  unsigned long long addr;
+  bool has_target = info.Length() > 3 && info[3].IsTypedArray();
+  if (!get_address(info[1], addr) || !info[2].IsNumber())
   {
     Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  pid_t target_pid = info[0].As<Napi::Number>().Int32Value();
-  int new_height = info[1].As<Napi::Number>().Int32Value();
-  int new_width = info[2].As<Napi::Number>().Int32Value();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+  size_t len;
+  if (!get_length(env, info[2], len))
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom property = XInternAtom(display, "_NET_CLIENT_LIST", true);
-  Atom actual_type;
-  int actual_format;
-  unsigned long num_windows, bytes_remaining;
-  unsigned char *data = NULL;
-
-  if (XGetWindowProperty(display, root, property, 0, (~0L), false, AnyPropertyType,
-                         &actual_type, &actual_format, &num_windows, &bytes_remaining, &data) != Success)
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
   {
-    Napi::Error::New(env, "Failed to get window list").ThrowAsJavaScriptException();
-    XCloseDisplay(display);
     return env.Null();
   }
 
-  Window *window_list = (Window *)data;
+  Napi::TypedArray target;
+  if (has_target)
+  {
+    target = info[3].As<Napi::TypedArray>();
+    if (target.ByteLength() < len)
+    {
+      Napi::RangeError::New(env, "Target buffer is too small").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  else
+  {
+    target = Napi::Buffer<unsigned char>::New(env, len);
+  }
 
-  for (unsigned long i = 0; i < num_windows; ++i)
+  if (!valid_signal(info[has_target ? 4 : 3]))
   {
-    Window window = window_list[i];
-    Atom pid_property = XInternAtom(display, "_NET_WM_PID", true);
-    Atom pid_type;
-    int pid_format;
-    unsigned long pid_nitems, pid_bytes_remaining;
-    unsigned char *pid_data = NULL;
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    if (XGetWindowProperty(display, window, pid_property, 0, 1, false, XA_CARDINAL,
-                           &pid_type, &pid_format, &pid_nitems, &pid_bytes_remaining, &pid_data) == Success)
-    {
-      if (pid_data != NULL)
-      {
-        pid_t pid = *((pid_t *)pid_data);
-        XFree(pid_data);
+  ReadBytesWorker *worker = new ReadBytesWorker(env, proc, addr, len, target, has_target);
+  Napi::Promise promise = worker->promise();
+  if (worker->watch_signal(info[has_target ? 4 : 3]))
+  {
+    worker->Queue();
+  }
+  else
+  {
+    delete worker;
+  }
+  return promise;
+}
 
-        if (pid == target_pid)
-        {
-          // Get the current geometry of the window
-          XWindowAttributes attrs;
-          XGetWindowAttributes(display, window, &attrs);
+class ReadBatchWorker : public PromiseWorker
+{
+public:
+  ReadBatchWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, std::vector<MemoryRange> &ranges, Napi::Buffer<unsigned char> data)
+      : PromiseWorker(env, proc), data(Napi::Persistent(data)), ok(ranges.size())
+  {
+    this->ranges.swap(ranges);
+  }
 
-          // Set the window height to the new value
-          XMoveResizeWindow(display, window, attrs.x, attrs.y, new_width, new_height);
-          break;
-        }
-      }
-    }
+protected:
+  void Execute() override
+  {
+    ExportScope scope(export_id);
+    read_ranges(*proc, ranges.data(), ranges.size(), ok.data());
   }
 
-  XFree(window_list);
-  XCloseDisplay(display);
+  Napi::Value result(Napi::Env env) override
+  {
+    return batch_result(env, data.Value(), ranges, ok);
+  }
 
-  return env.Null();
-}
+private:
+  Napi::Reference<Napi::Buffer<unsigned char>> data;
+  std::vector<MemoryRange> ranges;
+  std::vector<unsigned char> ok;
+};
 
-Napi::Value get_async_key_state(const Napi::CallbackInfo &info)
+// read_batch_async(pid, addresses, sizes[, options])
+Napi::Value read_batch_async(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
-  if (info.Length() < 1)
+  if (info.Length() < 3)
   {
     Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!info[0].IsNumber())
+  std::vector<MemoryRange> ranges;
+  size_t total;
+  if (!get_batch_ranges(info, ranges, total))
   {
-    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  int key_code = info[0].As<Napi::Number>().Int32Value();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  if (!proc)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  char keys_return[32];
-  XQueryKeymap(display, keys_return);
-  KeyCode kc = XKeysymToKeycode(display, key_code);
-  bool is_pressed = (keys_return[kc / 8] & (1 << (kc % 8))) != 0;
-
-  XCloseDisplay(display);
+  Napi::Buffer<unsigned char> data = Napi::Buffer<unsigned char>::New(env, total);
+  place_batch_ranges(ranges, data.Data());
+  if (!valid_signal(info[3]))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-  return Napi::Boolean::New(env, is_pressed);
+  ReadBatchWorker *worker = new ReadBatchWorker(env, proc, ranges, data);
+  Napi::Promise promise = worker->promise();
+  if (worker->watch_signal(info[3]))
+  {
+    worker->Queue();
+  }
+  else
+  {
+    delete worker;
+  }
+  return promise;
 }
 
-Napi::Object get_screen_size(const Napi::CallbackInfo &info)
+class PointerScanWorker : public PromiseWorker
 {
-  Napi::Env env = info.Env();
-
-  Display *display = XOpenDisplay(NULL);
-  if (display == NULL)
+public:
+  PointerScanWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, std::shared_ptr<const ProcessMaps> maps,
+                    unsigned long long target, const PointerScanOptions &options)
+      : PromiseWorker(env, proc), maps(maps), target(target), options(options)
   {
-    Napi::Error::New(env, "Failed to open X display").ThrowAsJavaScriptException();
-    return Napi::Object::New(env);
   }
 
-  int screen_num = DefaultScreen(display);
-  int screen_width = DisplayWidth(display, screen_num);
-  int screen_height = DisplayHeight(display, screen_num);
-
-  XCloseDisplay(display);
-
-  Napi::Object result = Napi::Object::New(env);
-  result.Set("width", Napi::Number::New(env, screen_width));
-  result.Set("height", Napi::Number::New(env, screen_height));
-
-  return result;
-}
-
-bool compare_bytes(const unsigned char *data, const std::vector<unsigned char> &signature, const std::vector<bool> &mask)
-{
-  for (size_t i = 0; i < signature.size(); ++i)
+protected:
+  void Execute() override
   {
-    if (!mask[i] && data[i] != signature[i])
+    ExportScope scope(export_id);
+    std::string error;
+    if (!run_pointer_scan(*proc, *maps, target, options, stats, cancel_flag(), error))
     {
-      return false;
+      SetError(error);
     }
   }
-  return true;
-}
 
-Napi::Value sigscan(const Napi::CallbackInfo &info)
+  Napi::Value result(Napi::Env env) override
+  {
+    return pointer_scan_result(env, stats);
+  }
+
+private:
+  std::shared_ptr<const ProcessMaps> maps;
+  unsigned long long target;
+  PointerScanOptions options;
+  PointerScanStats stats;
+};
+
+// pointer_scan_async(pid, target, options) is pointer_scan on the libuv
+// thread pool; options.signal cancels it.
+Napi::Value pointer_scan_async(const Napi::CallbackInfo &info)
 {
   Napi::Env env = info.Env();
 
@@ -830,82 +9800,114 @@ Napi::Value sigscan(const Napi::CallbackInfo &info)
     return env.Null();
   }
 
-  if (!info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsString())
+  unsigned long long target;
+  PointerScanOptions options;
+  if (!get_address(info[1], target) || !get_pointer_scan_options(info[2], options))
   {
     Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  pid_t pid = info[0].As<Napi::Number>().Int32Value();
-  unsigned long start_addr = info[1].As<Napi::Number>().Uint32Value();
-  std::string sig_str = info[2].As<Napi::String>().Utf8Value();
-
-  std::vector<unsigned char> signature;
-  std::vector<bool> mask;
-  std::istringstream ss(sig_str);
-  std::string byte_str;
-  while (std::getline(ss, byte_str, ' '))
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
   {
-    if (byte_str == "??")
-    {
-      signature.push_back(0);
-      mask.push_back(true);
-    }
-    else
-    {
-      signature.push_back(static_cast<unsigned char>(std::stoi(byte_str, nullptr, 16)));
-      mask.push_back(false);
-    }
+    return env.Null();
   }
 
-  ptrace(PTRACE_INTERRUPT, pid, NULL, PTRACE_O_TRACEEXEC);
-  std::stringstream mem_ss;
-  mem_ss << "/proc/" << pid << "/mem";
-  std::fstream fs(mem_ss.str().c_str(), std::ios::in | std::ios::out | std::ios::binary);
-
-  if (!fs.is_open())
+  if (!valid_signal(info[2]))
   {
-    Napi::Error::New(env, "Failed to open " + mem_ss.str()).ThrowAsJavaScriptException();
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  fs.seekg(start_addr);
+  PointerScanWorker *worker = new PointerScanWorker(env, proc, maps, target, options);
+  Napi::Promise promise = worker->promise();
+  if (worker->watch_signal(info[2]))
+  {
+    worker->Queue();
+  }
+  else
+  {
+    delete worker;
+  }
+  return promise;
+}
 
-  const size_t buffer_size = 4096;
-  unsigned char buffer[buffer_size];
-  unsigned long address = 0;
-  bool found = false;
+class DumpWorker : public PromiseWorker
+{
+public:
+  DumpWorker(Napi::Env env, std::shared_ptr<ProcessMemory> proc, std::shared_ptr<const ProcessMaps> maps, const DumpOptions &options)
+      : PromiseWorker(env, proc), maps(maps), options(options)
+  {
+  }
 
-  while (fs.read(reinterpret_cast<char *>(buffer), buffer_size))
+protected:
+  void Execute() override
   {
-    for (size_t i = 0; i < buffer_size - signature.size() + 1; ++i)
+    ExportScope scope(export_id);
+    std::string error;
+    if (!run_dump(*proc, *maps, options, layout, stats, cancel_flag(), error))
     {
-      if (compare_bytes(buffer + i, signature, mask))
-      {
-        found = true;
-        address += i;
-        break;
-      }
+      SetError(error);
     }
+  }
 
-    if (found)
-    {
-      break;
-    }
+  Napi::Value result(Napi::Env env) override
+  {
+    return dump_result(env, layout, stats);
+  }
+
+private:
+  std::shared_ptr<const ProcessMaps> maps;
+  DumpOptions options;
+  std::vector<DumpChunk> layout;
+  DumpStats stats;
+};
+
+// dump_memory_async(pid, options) is dump_memory on the libuv thread pool;
+// options.signal cancels it.
+Napi::Value dump_memory_async(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    address += buffer_size - signature.size() + 1;
-    fs.seekg(start_addr + address);
+  DumpOptions options;
+  if (!get_dump_options(info[1], options))
+  {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
+    return env.Null();
   }
-  fs.close();
 
-  if (found)
+  std::shared_ptr<ProcessMemory> proc = get_process(env, info[0]);
+  std::shared_ptr<const ProcessMaps> maps = proc ? get_process_maps(env, info[0], MAPS_CHECKED) : nullptr;
+  if (!maps)
   {
-    return Napi::Number::New(env, start_addr + address);
+    return env.Null();
   }
-  else
+
+  if (!valid_signal(info[1]))
   {
+    Napi::TypeError::New(env, "Wrong argument types").ThrowAsJavaScriptException();
     return env.Null();
   }
+
+  DumpWorker *worker = new DumpWorker(env, proc, maps, options);
+  Napi::Promise promise = worker->promise();
+  if (worker->watch_signal(info[1]))
+  {
+    worker->Queue();
+  }
+  else
+  {
+    delete worker;
+  }
+  return promise;
 }
 
 void messageBox(const std::string &title, const std::string &message)
@@ -1043,40 +10045,348 @@ Napi::Value computer_id(const Napi::CallbackInfo &info)
   return Napi::String::New(env, computer_id);
 }
 
+struct ExportTotals
+{
+  uint64_t calls = 0;
+  uint64_t errors = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t latency[STATS_BUCKETS] = {};
+};
+
+std::vector<ExportTotals> stats_baseline;
+
+// Returns the export's id, registering it on first sight; -1 once the table
+// is full. Every addon instance registers the same names.
+int register_export(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  for (size_t i = 0; i < stats_exports.size(); ++i)
+  {
+    if (stats_exports[i] == name)
+    {
+      return i;
+    }
+  }
+  if (stats_exports.size() == STATS_MAX_EXPORTS)
+  {
+    return -1;
+  }
+  stats_exports.push_back(name);
+  return stats_exports.size() - 1;
+}
+
+// Sums every thread's counters. Must be called with stats_mutex held.
+std::vector<ExportTotals> sum_stats()
+{
+  std::vector<ExportTotals> totals(stats_exports.size());
+  for (StatsSlot *slot : stats_slots)
+  {
+    for (size_t id = 0; id < totals.size(); ++id)
+    {
+      ExportCounters *counters = slot->exports[id].load(std::memory_order_acquire);
+      if (!counters)
+      {
+        continue;
+      }
+      ExportTotals &total = totals[id];
+      total.calls += counters->calls.load(std::memory_order_relaxed);
+      total.errors += counters->errors.load(std::memory_order_relaxed);
+      total.bytes_read += counters->bytes_read.load(std::memory_order_relaxed);
+      total.bytes_written += counters->bytes_written.load(std::memory_order_relaxed);
+      for (size_t b = 0; b < STATS_BUCKETS; ++b)
+      {
+        total.latency[b] += counters->latency[b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return totals;
+}
+
+// Times one call of an export on the calling thread. A call counts as an
+// error unless it returned without an exception pending.
+class CallTimer
+{
+public:
+  explicit CallTimer(int id) : id(id), started(std::chrono::steady_clock::now()) {}
+
+  ~CallTimer()
+  {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+    ExportCounters *counters = export_counters(id);
+    stats_add(counters->calls, 1);
+    stats_add(counters->errors, failed);
+    stats_add(counters->latency[latency_bucket(ns)], 1);
+  }
+
+  bool failed = true;
+
+private:
+  int id;
+  std::chrono::steady_clock::time_point started;
+};
+
+// Registers fn under name for get_stats() and wraps it to count its calls.
+template <typename Result>
+Napi::Function instrumented(Napi::Env env, const char *name, Result (*fn)(const Napi::CallbackInfo &))
+{
+  int id = register_export(name);
+  if (id < 0)
+  {
+    return Napi::Function::New(env, fn, name);
+  }
+  return Napi::Function::New(env, [fn, id](const Napi::CallbackInfo &info) -> Napi::Value
+                             {
+                               ExportScope scope(id);
+                               CallTimer timer(id);
+                               Napi::Value result = fn(info);
+                               timer.failed = info.Env().IsExceptionPending();
+                               return result; },
+                             name);
+}
+
+// get_stats() returns { [export]: { calls, errors, bytesRead, bytesWritten,
+// p50Us, p99Us, maxUs } } for every export used since the last
+// reset_stats(). Latencies are the upper bound of their bucket and cover the
+// synchronous part of a call; bytes also count work done on native threads
+// for it (scans, async exports, watchers, samplers).
+Napi::Value get_stats(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+  std::vector<ExportTotals> totals;
+  std::vector<std::string> names;
+  std::vector<ExportTotals> baseline;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    totals = sum_stats();
+    names = stats_exports;
+    baseline = stats_baseline;
+  }
+  baseline.resize(totals.size());
+
+  Napi::Object result = Napi::Object::New(env);
+  for (size_t id = 0; id < totals.size(); ++id)
+  {
+    ExportTotals &total = totals[id];
+    const ExportTotals &base = baseline[id];
+    total.calls -= base.calls;
+    total.errors -= base.errors;
+    total.bytes_read -= base.bytes_read;
+    total.bytes_written -= base.bytes_written;
+    if (total.calls == 0 && total.bytes_read == 0 && total.bytes_written == 0)
+    {
+      continue;
+    }
+
+    double p50 = 0, p99 = 0, max = 0;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < STATS_BUCKETS; ++b)
+    {
+      uint64_t count = total.latency[b] - base.latency[b];
+      if (count == 0)
+      {
+        continue;
+      }
+      double limit = bucket_limit(b) / 1000.0;
+      if (seen < (total.calls + 1) / 2 && seen + count >= (total.calls + 1) / 2)
+      {
+        p50 = limit;
+      }
+      uint64_t rank99 = total.calls - total.calls / 100;
+      if (seen < rank99 && seen + count >= rank99)
+      {
+        p99 = limit;
+      }
+      seen += count;
+      max = limit;
+    }
+
+    Napi::Object item = Napi::Object::New(env);
+    item.Set("calls", Napi::Number::New(env, total.calls));
+    item.Set("errors", Napi::Number::New(env, total.errors));
+    item.Set("bytesRead", Napi::Number::New(env, total.bytes_read));
+    item.Set("bytesWritten", Napi::Number::New(env, total.bytes_written));
+    item.Set("p50Us", Napi::Number::New(env, p50));
+    item.Set("p99Us", Napi::Number::New(env, p99));
+    item.Set("maxUs", Napi::Number::New(env, max));
+    result.Set(names[id], item);
+  }
+  return result;
+}
+
+Napi::Value reset_stats(const Napi::CallbackInfo &info)
+{
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  stats_baseline = sum_stats();
+  return info.Env().Null();
+}
+
 Napi::Object Init(Napi::Env env, Napi::Object exports)
 {
+  AddonData *data = new AddonData();
+  data->process_handle = Napi::Persistent(ProcessHandle::Define(env));
+  data->signature_handle = Napi::Persistent(SignatureHandle::Define(env));
+  data->value_scan = Napi::Persistent(ValueScan::Define(env));
+  data->snapshot = Napi::Persistent(Snapshot::Define(env));
+  data->watcher = Napi::Persistent(Watcher::Define(env));
+  data->struct_layout = Napi::Persistent(StructLayout::Define(env));
+  data->sampler = Napi::Persistent(Sampler::Define(env));
+  env.SetInstanceData(data);
+
+  exports.Set(Napi::String::New(env, "open_process"),
+              instrumented(env, "open_process", open_process));
+  exports.Set(Napi::String::New(env, "freeze"),
+              instrumented(env, "freeze", freeze));
+  exports.Set(Napi::String::New(env, "thaw"),
+              instrumented(env, "thaw", thaw));
   exports.Set(Napi::String::New(env, "read_integer"),
-              Napi::Function::New(env, read_integer));
+              instrumented(env, "read_integer", read_integer));
   exports.Set(Napi::String::New(env, "write_integer"),
-              Napi::Function::New(env, write_integer));
+              instrumented(env, "write_integer", write_integer));
+  exports.Set(Napi::String::New(env, "read_batch"),
+              instrumented(env, "read_batch", read_batch));
+  exports.Set(Napi::String::New(env, "read_batch_multi"),
+              instrumented(env, "read_batch_multi", read_batch_multi));
+  exports.Set(Napi::String::New(env, "pin_worker_pool"),
+              instrumented(env, "pin_worker_pool", pin_worker_pool));
+  exports.Set(Napi::String::New(env, "write_batch"),
+              instrumented(env, "write_batch", write_batch));
+  exports.Set(Napi::String::New(env, "read_i8"),
+              instrumented(env, "read_i8", read_value<TYPE_I8>));
+  exports.Set(Napi::String::New(env, "read_u8"),
+              instrumented(env, "read_u8", read_value<TYPE_U8>));
+  exports.Set(Napi::String::New(env, "read_i16"),
+              instrumented(env, "read_i16", read_value<TYPE_I16>));
+  exports.Set(Napi::String::New(env, "read_u16"),
+              instrumented(env, "read_u16", read_value<TYPE_U16>));
+  exports.Set(Napi::String::New(env, "read_i32"),
+              instrumented(env, "read_i32", read_value<TYPE_I32>));
+  exports.Set(Napi::String::New(env, "read_u32"),
+              instrumented(env, "read_u32", read_value<TYPE_U32>));
+  exports.Set(Napi::String::New(env, "read_i64"),
+              instrumented(env, "read_i64", read_value<TYPE_I64>));
+  exports.Set(Napi::String::New(env, "read_u64"),
+              instrumented(env, "read_u64", read_value<TYPE_U64>));
+  exports.Set(Napi::String::New(env, "read_f32"),
+              instrumented(env, "read_f32", read_value<TYPE_F32>));
+  exports.Set(Napi::String::New(env, "read_f64"),
+              instrumented(env, "read_f64", read_value<TYPE_F64>));
+  exports.Set(Napi::String::New(env, "read_bytes"),
+              instrumented(env, "read_bytes", read_bytes));
+  exports.Set(Napi::String::New(env, "write_i8"),
+              instrumented(env, "write_i8", write_value<TYPE_I8>));
+  exports.Set(Napi::String::New(env, "write_u8"),
+              instrumented(env, "write_u8", write_value<TYPE_U8>));
+  exports.Set(Napi::String::New(env, "write_i16"),
+              instrumented(env, "write_i16", write_value<TYPE_I16>));
+  exports.Set(Napi::String::New(env, "write_u16"),
+              instrumented(env, "write_u16", write_value<TYPE_U16>));
+  exports.Set(Napi::String::New(env, "write_i32"),
+              instrumented(env, "write_i32", write_value<TYPE_I32>));
+  exports.Set(Napi::String::New(env, "write_u32"),
+              instrumented(env, "write_u32", write_value<TYPE_U32>));
+  exports.Set(Napi::String::New(env, "write_i64"),
+              instrumented(env, "write_i64", write_value<TYPE_I64>));
+  exports.Set(Napi::String::New(env, "write_u64"),
+              instrumented(env, "write_u64", write_value<TYPE_U64>));
+  exports.Set(Napi::String::New(env, "write_f32"),
+              instrumented(env, "write_f32", write_value<TYPE_F32>));
+  exports.Set(Napi::String::New(env, "write_f64"),
+              instrumented(env, "write_f64", write_value<TYPE_F64>));
+  exports.Set(Napi::String::New(env, "write_bytes"),
+              instrumented(env, "write_bytes", write_bytes));
+  exports.Set(Napi::String::New(env, "resolve_pointer_chain"),
+              instrumented(env, "resolve_pointer_chain", resolve_pointer_chain));
+  exports.Set(Napi::String::New(env, "resolve_pointer_chains"),
+              instrumented(env, "resolve_pointer_chains", resolve_pointer_chains_batch));
+  exports.Set(Napi::String::New(env, "define_struct"),
+              instrumented(env, "define_struct", define_struct));
+  exports.Set(Napi::String::New(env, "read_struct"),
+              instrumented(env, "read_struct", read_struct));
+  exports.Set(Napi::String::New(env, "read_struct_array"),
+              instrumented(env, "read_struct_array", read_struct_array));
+  exports.Set(Napi::String::New(env, "get_module_base"),
+              instrumented(env, "get_module_base", get_module_base));
+  exports.Set(Napi::String::New(env, "find_region"),
+              instrumented(env, "find_region", find_region));
+  exports.Set(Napi::String::New(env, "list_regions"),
+              instrumented(env, "list_regions", list_regions));
+  exports.Set(Napi::String::New(env, "refresh_maps"),
+              instrumented(env, "refresh_maps", refresh_maps));
+  exports.Set(Napi::String::New(env, "resolve_symbol"),
+              instrumented(env, "resolve_symbol", resolve_symbol));
+  exports.Set(Napi::String::New(env, "symbolize"),
+              instrumented(env, "symbolize", symbolize));
   exports.Set(Napi::String::New(env, "get_pid_from_window_title"),
-              Napi::Function::New(env, get_pid_from_window_title));
+              instrumented(env, "get_pid_from_window_title", get_pid_from_window_title));
   exports.Set(Napi::String::New(env, "get_pids_from_partial_title"),
-              Napi::Function::New(env, get_pids_from_partial_title));
+              instrumented(env, "get_pids_from_partial_title", get_pids_from_partial_title));
   exports.Set(Napi::String::New(env, "get_window_title_by_pid"),
-              Napi::Function::New(env, get_window_title_by_pid));
+              instrumented(env, "get_window_title_by_pid", get_window_title_by_pid));
   exports.Set(Napi::String::New(env, "disable_window_input"),
-              Napi::Function::New(env, disable_window_input));
+              instrumented(env, "disable_window_input", disable_window_input));
   exports.Set(Napi::String::New(env, "enable_window_input"),
-              Napi::Function::New(env, enable_window_input));
+              instrumented(env, "enable_window_input", enable_window_input));
   exports.Set(Napi::String::New(env, "make_window_topmost"),
-              Napi::Function::New(env, make_window_topmost));
+              instrumented(env, "make_window_topmost", make_window_topmost));
   exports.Set(Napi::String::New(env, "create_browser_window"),
-              Napi::Function::New(env, create_browser_window));
+              instrumented(env, "create_browser_window", create_browser_window));
   exports.Set(Napi::String::New(env, "set_window_size_by_pid"),
-              Napi::Function::New(env, set_window_size_by_pid));
+              instrumented(env, "set_window_size_by_pid", set_window_size_by_pid));
   exports.Set(Napi::String::New(env, "get_async_key_state"),
-              Napi::Function::New(env, get_async_key_state));
+              instrumented(env, "get_async_key_state", get_async_key_state));
+  exports.Set(Napi::String::New(env, "compile_signature"),
+              instrumented(env, "compile_signature", compile_signature));
   exports.Set(Napi::String::New(env, "sigscan"),
-              Napi::Function::New(env, sigscan));
+              instrumented(env, "sigscan", sigscan));
+  exports.Set(Napi::String::New(env, "sigscan_async"),
+              instrumented(env, "sigscan_async", sigscan_async));
+  exports.Set(Napi::String::New(env, "sigscan_all"),
+              instrumented(env, "sigscan_all", sigscan_all));
+  exports.Set(Napi::String::New(env, "sigscan_all_async"),
+              instrumented(env, "sigscan_all_async", sigscan_all_async));
+  exports.Set(Napi::String::New(env, "first_scan"),
+              instrumented(env, "first_scan", first_scan));
+  exports.Set(Napi::String::New(env, "next_scan"),
+              instrumented(env, "next_scan", next_scan));
+  exports.Set(Napi::String::New(env, "take_snapshot"),
+              instrumented(env, "take_snapshot", take_snapshot));
+  exports.Set(Napi::String::New(env, "diff_snapshots"),
+              instrumented(env, "diff_snapshots", diff_snapshots));
+  exports.Set(Napi::String::New(env, "watch"),
+              instrumented(env, "watch", watch));
+  exports.Set(Napi::String::New(env, "start_sampler"),
+              instrumented(env, "start_sampler", start_sampler));
+  exports.Set(Napi::String::New(env, "sigscan_many"),
+              instrumented(env, "sigscan_many", sigscan_many));
+  exports.Set(Napi::String::New(env, "read_bytes_async"),
+              instrumented(env, "read_bytes_async", read_bytes_async));
+  exports.Set(Napi::String::New(env, "read_batch_async"),
+              instrumented(env, "read_batch_async", read_batch_async));
+  exports.Set(Napi::String::New(env, "pointer_scan"),
+              instrumented(env, "pointer_scan", pointer_scan));
+  exports.Set(Napi::String::New(env, "pointer_scan_async"),
+              instrumented(env, "pointer_scan_async", pointer_scan_async));
+  exports.Set(Napi::String::New(env, "read_pointer_scan"),
+              instrumented(env, "read_pointer_scan", read_pointer_scan));
+  exports.Set(Napi::String::New(env, "intersect_pointer_scans"),
+              instrumented(env, "intersect_pointer_scans", intersect_pointer_scans));
+  exports.Set(Napi::String::New(env, "dump_memory"),
+              instrumented(env, "dump_memory", dump_memory));
+  exports.Set(Napi::String::New(env, "dump_memory_async"),
+              instrumented(env, "dump_memory_async", dump_memory_async));
   exports.Set(Napi::String::New(env, "get_screen_size"),
-              Napi::Function::New(env, get_screen_size));
+              instrumented(env, "get_screen_size", get_screen_size));
   exports.Set(Napi::String::New(env, "show_message_box"),
-              Napi::Function::New(env, show_message_box));
+              instrumented(env, "show_message_box", show_message_box));
   exports.Set(Napi::String::New(env, "get_input_dialog"),
-              Napi::Function::New(env, get_input_dialog));
+              instrumented(env, "get_input_dialog", get_input_dialog));
   exports.Set(Napi::String::New(env, "computer_id"),
-              Napi::Function::New(env, computer_id));
+              instrumented(env, "computer_id", computer_id));
+  exports.Set(Napi::String::New(env, "get_stats"),
+              Napi::Function::New(env, get_stats));
+  exports.Set(Napi::String::New(env, "reset_stats"),
+              Napi::Function::New(env, reset_stats));
   return exports;
 }
 